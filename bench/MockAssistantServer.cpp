@@ -0,0 +1,349 @@
+#include "MockAssistantServer.h"
+
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+#if defined(_WIN32)
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
+	#pragma comment(lib, "ws2_32.lib")
+	using socklen_t = int;
+	using NativeSocket = SOCKET;
+	static void CloseSocket(intptr_t s) { closesocket((SOCKET)s); }
+	static void ShutdownSocket(intptr_t s) { shutdown((SOCKET)s, SD_BOTH); }
+	#define INVALID_SOCK ((intptr_t)INVALID_SOCKET)
+	#define SEND_FLAGS 0
+#else
+	#include <sys/socket.h>
+	#include <netinet/in.h>
+	#include <netinet/tcp.h>
+	#include <arpa/inet.h>
+	#include <unistd.h>
+	using NativeSocket = int;
+	static void CloseSocket(intptr_t s) { close((int)s); }
+	static void ShutdownSocket(intptr_t s) { shutdown((int)s, SHUT_RDWR); }
+	#define INVALID_SOCK ((intptr_t)-1)
+	#define SEND_FLAGS MSG_NOSIGNAL // client hung up is a normal case here
+#endif
+
+static bool SendAll(intptr_t Socket, const char* Data, size_t Size)
+{
+	while (Size > 0)
+	{
+		const int Sent = send((NativeSocket)Socket, Data, (int)std::min<size_t>(Size, 1 << 20), SEND_FLAGS);
+		if (Sent <= 0)
+			return false;
+		Data += Sent;
+		Size -= Sent;
+	}
+	return true;
+}
+
+static void AppendEscaped(std::string& Out, std::string_view Str)
+{
+	for (char c : Str)
+	{
+		switch (c)
+		{
+			case '"': Out += "\\\""; break;
+			case '\\': Out += "\\\\"; break;
+			case '\n': Out += "\\n"; break;
+			default: Out += c; break;
+		}
+	}
+}
+
+void MockStreamConfig::Parse(std::string_view Query)
+{
+	while (!Query.empty())
+	{
+		const size_t Amp = std::min(Query.find('&'), Query.size());
+		const std::string_view Pair = Query.substr(0, Amp);
+		Query.remove_prefix(std::min(Amp + 1, Query.size()));
+
+		const size_t Eq = Pair.find('=');
+		if (Eq == std::string_view::npos)
+			continue;
+
+		const std::string_view Key = Pair.substr(0, Eq);
+		const std::string Value(Pair.substr(Eq + 1));
+
+		if (Key == "tokens") Tokens = atoi(Value.c_str());
+		else if (Key == "rate") Rate = (float)atof(Value.c_str());
+		else if (Key == "delay") Delay = (float)atof(Value.c_str());
+		else if (Key == "frag") Frag = atoi(Value.c_str());
+		else if (Key == "disconnect") Disconnect = atoi(Value.c_str());
+		else if (Key == "malformed") Malformed = atoi(Value.c_str());
+		else if (Key == "seed") Seed = atoi(Value.c_str());
+	}
+}
+
+// some tokens need escaping or are multibyte, keeps the parser honest
+std::string MockStreamConfig::Token(int Index)
+{
+	switch (Index % 16)
+	{
+		case 5: return "\"quoted\" ";
+		case 9: return "caf\xC3\xA9 ";
+		case 13: return "line\n";
+		default: return "tok" + std::to_string(Index) + " ";
+	}
+}
+
+std::string MockStreamConfig::Expected() const
+{
+	std::string Text;
+	const int Count = (Disconnect >= 0) ? std::min(Disconnect, Tokens) : Tokens;
+	for (int i = 0; i < Count; ++i)
+		Text += Token(i);
+	return Text;
+}
+
+std::string MockAssistantServer::GetUrl() const
+{
+	return "http://127.0.0.1:" + std::to_string(Port) + "/v1/chat/completions";
+}
+
+bool MockAssistantServer::Start(int InPort)
+{
+	#if defined(_WIN32)
+	WSADATA Wsa;
+	if (WSAStartup(MAKEWORD(2, 2), &Wsa) != 0)
+		return false;
+	#endif
+
+	Listener = (intptr_t)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (Listener == INVALID_SOCK)
+		return false;
+
+	int Yes = 1;
+	setsockopt((NativeSocket)Listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&Yes, sizeof(Yes));
+
+	sockaddr_in Addr {};
+	Addr.sin_family = AF_INET;
+	Addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	Addr.sin_port = htons((uint16_t)InPort);
+
+	socklen_t AddrLen = sizeof(Addr);
+	if (bind((NativeSocket)Listener, (sockaddr*)&Addr, sizeof(Addr)) != 0
+		|| listen((NativeSocket)Listener, 64) != 0
+		|| getsockname((NativeSocket)Listener, (sockaddr*)&Addr, &AddrLen) != 0)
+	{
+		CloseSocket(Listener);
+		Listener = INVALID_SOCK;
+		return false;
+	}
+
+	Port = ntohs(Addr.sin_port);
+	StopFlag = false;
+	AcceptThread = std::thread(&MockAssistantServer::AcceptLoop, this);
+	return true;
+}
+
+void MockAssistantServer::Stop()
+{
+	if (Listener == INVALID_SOCK)
+		return;
+
+	StopFlag = true;
+	ShutdownSocket(Listener); // unblocks accept
+	CloseSocket(Listener);
+	Listener = INVALID_SOCK;
+
+	if (AcceptThread.joinable())
+		AcceptThread.join();
+
+	{
+		std::lock_guard<std::mutex> Lock(ClientMutex);
+		for (auto Client : Clients)
+			ShutdownSocket(Client); // unblocks recv
+	}
+	for (auto& Thread : ClientThreads)
+		Thread.join();
+	ClientThreads.clear();
+	Clients.clear();
+
+	#if defined(_WIN32)
+	WSACleanup();
+	#endif
+}
+
+void MockAssistantServer::AcceptLoop()
+{
+	while (!StopFlag)
+	{
+		const intptr_t Client = (intptr_t)accept((NativeSocket)Listener, nullptr, nullptr);
+		if (Client == INVALID_SOCK)
+		{
+			if (StopFlag)
+				break;
+			continue;
+		}
+
+		int Yes = 1;
+		setsockopt((NativeSocket)Client, IPPROTO_TCP, TCP_NODELAY, (const char*)&Yes, sizeof(Yes)); // fragments must go out as they are
+
+		NumConnections++;
+		std::lock_guard<std::mutex> Lock(ClientMutex);
+		Clients.push_back(Client);
+		ClientThreads.emplace_back(&MockAssistantServer::ServeConnection, this, Client);
+	}
+}
+
+void MockAssistantServer::ServeConnection(intptr_t Socket)
+{
+	std::string In;
+	char Buf[16 * 1024];
+	bool KeepAlive = true;
+
+	while (KeepAlive && !StopFlag)
+	{
+		// headers
+		size_t HeaderEnd;
+		while ((HeaderEnd = In.find("\r\n\r\n")) == std::string::npos)
+		{
+			const int Got = recv((NativeSocket)Socket, Buf, sizeof(Buf), 0);
+			if (Got <= 0)
+			{
+				KeepAlive = false;
+				break;
+			}
+			In.append(Buf, Got);
+		}
+		if (!KeepAlive)
+			break;
+
+		const std::string Header = In.substr(0, HeaderEnd);
+		In.erase(0, HeaderEnd + 4);
+
+		std::string Lower = Header;
+		std::transform(Lower.begin(), Lower.end(), Lower.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+
+		size_t ContentLength = 0;
+		if (const size_t Pos = Lower.find("content-length:"); Pos != std::string::npos)
+			ContentLength = (size_t)atoll(Lower.c_str() + Pos + 15);
+		if (Lower.find("connection: close") != std::string::npos)
+			KeepAlive = false;
+
+		// body, not interested in the prompt
+		while (In.size() < ContentLength)
+		{
+			const int Got = recv((NativeSocket)Socket, Buf, sizeof(Buf), 0);
+			if (Got <= 0)
+			{
+				KeepAlive = false;
+				break;
+			}
+			In.append(Buf, Got);
+		}
+		if (!KeepAlive && In.size() < ContentLength)
+			break;
+		In.erase(0, ContentLength);
+
+		const size_t MethodEnd = Header.find(' ');
+		const size_t TargetEnd = Header.find(' ', MethodEnd + 1);
+		const std::string Method = Header.substr(0, MethodEnd);
+		const std::string Target = Header.substr(MethodEnd + 1, TargetEnd - MethodEnd - 1);
+
+		if (Method != "POST")
+		{
+			const char* Reply = "HTTP/1.1 405 Method Not Allowed\r\nContent-Length: 0\r\n\r\n";
+			if (!SendAll(Socket, Reply, strlen(Reply)))
+				break;
+			continue;
+		}
+
+		MockStreamConfig Config = Defaults;
+		if (const size_t Query = Target.find('?'); Query != std::string::npos)
+			Config.Parse(std::string_view(Target).substr(Query + 1));
+
+		NumRequests++;
+		if (!Respond(Socket, Config))
+			break;
+	}
+
+	std::lock_guard<std::mutex> Lock(ClientMutex); // Stop must not shutdown a reused handle
+	Clients.erase(std::remove(Clients.begin(), Clients.end(), Socket), Clients.end());
+	ShutdownSocket(Socket);
+	CloseSocket(Socket);
+}
+
+// false closes the connection
+bool MockAssistantServer::Respond(intptr_t Socket, const MockStreamConfig& Config)
+{
+	using Clock = std::chrono::steady_clock;
+
+	const char* Head = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nTransfer-Encoding: chunked\r\n\r\n";
+	if (!SendAll(Socket, Head, strlen(Head)))
+		return false;
+
+	std::mt19937 Rng(Config.Seed);
+	auto SendChunk = [&](std::string_view Data)
+	{
+		char Size[16];
+		const int Len = snprintf(Size, sizeof(Size), "%zx\r\n", Data.size());
+		return SendAll(Socket, Size, Len) && SendAll(Socket, Data.data(), Data.size()) && SendAll(Socket, "\r\n", 2);
+	};
+	auto SendData = [&](std::string_view Data)
+	{
+		if (Config.Frag <= 0)
+			return SendChunk(Data);
+		while (!Data.empty())
+		{
+			const size_t Piece = std::min<size_t>(Data.size(), 1 + Rng() % Config.Frag);
+			if (!SendChunk(Data.substr(0, Piece)))
+				return false;
+			Data.remove_prefix(Piece);
+		}
+		return true;
+	};
+
+	const auto Start = Clock::now();
+	const bool Paced = Config.Rate > 0;
+	std::string Out;
+
+	if (Config.Delay > 0)
+		std::this_thread::sleep_for(std::chrono::duration<double>(Config.Delay));
+
+	for (int i = 0; i < Config.Tokens; ++i)
+	{
+		if (Config.Disconnect >= 0 && i >= Config.Disconnect)
+		{
+			if (!Out.empty())
+				SendData(Out);
+			return false; // no terminating chunk, client must see an error
+		}
+
+		if (Config.Malformed > 0 && i > 0 && (i % Config.Malformed) == 0)
+		{
+			static const char* Broken[] = {
+				"data: {\"choices\":[{\"delta\":{\"content\":\"lost\n\n", // truncated json
+				"data: definitely not json\n\n",
+				"data: {\"choices\":[{\"delta\":{\"content\":42}}]}\n\n", // wrong type
+				"garbage line without colon\n\n",
+			};
+			Out += Broken[(i / Config.Malformed) % 4];
+		}
+
+		Out += "data: {\"choices\":[{\"index\":0,\"delta\":{\"content\":\"";
+		AppendEscaped(Out, MockStreamConfig::Token(i));
+		Out += "\"},\"finish_reason\":null}]}\n\n";
+
+		if (Paced)
+		{
+			std::this_thread::sleep_until(Start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(Config.Delay + i / Config.Rate)));
+			if (!SendData(Out))
+				return false;
+			Out.clear();
+		}
+	}
+
+	Out += "data: {\"choices\":[{\"index\":0,\"delta\":{},\"finish_reason\":\"stop\"}],\"usage\":{\"prompt_tokens\":16,\"completion_tokens\":";
+	Out += std::to_string(Config.Tokens);
+	Out += "}}\n\ndata: [DONE]\n\n";
+
+	return SendData(Out) && SendAll(Socket, "0\r\n\r\n", 5);
+}
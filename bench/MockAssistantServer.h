@@ -0,0 +1,64 @@
+#pragma once
+
+// Localhost OpenAI compatible /v1/chat/completions that streams fake tokens, for offline assistant tests.
+// Every request can override the defaults with query parameters on the url, e.g.
+//   http://127.0.0.1:port/v1/chat/completions?tokens=500&rate=200&frag=3&malformed=10
+// Keep-alive and chunked transfer like a real server, HEAD answers 405 (prewarm probe).
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <vector>
+
+struct MockStreamConfig
+{
+	int Tokens = 100; // deltas per response
+	float Rate = 0; // tokens per second, 0 writes whole response at once
+	float Delay = 0; // seconds before first token (prompt processing)
+	int Frag = 0; // split writes into 1..Frag byte pieces, 0 whole events
+	int Disconnect = -1; // drop connection after this many tokens, -1 never
+	int Malformed = 0; // insert broken event every N tokens, 0 never
+	int Seed = 1; // fragmentation pattern
+
+	void Parse(std::string_view Query); // key=value&key=value, unknown keys ignored
+
+	// content the client must end up with, malformed events excluded
+	static std::string Token(int Index);
+	std::string Expected() const;
+};
+
+class MockAssistantServer
+{
+public:
+
+	~MockAssistantServer() { Stop(); }
+
+	bool Start(int Port = 0); // 0 picks free port
+	void Stop();
+
+	int GetPort() const { return Port; }
+	std::string GetUrl() const;
+
+	MockStreamConfig Defaults;
+
+	std::atomic<uint64_t> NumRequests {0};
+	std::atomic<uint64_t> NumConnections {0};
+
+private:
+
+	void AcceptLoop();
+	void ServeConnection(intptr_t Socket);
+	bool Respond(intptr_t Socket, const MockStreamConfig& Config);
+
+	intptr_t Listener = -1;
+	int Port = 0;
+	std::atomic<bool> StopFlag {false};
+	std::thread AcceptThread;
+
+	std::mutex ClientMutex;
+	std::vector<intptr_t> Clients;
+	std::vector<std::thread> ClientThreads;
+};
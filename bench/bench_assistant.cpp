@@ -0,0 +1,334 @@
+// Assistant streaming against local mock server: TTFT, inter-token jitter, parser CPU per token, cancel latency
+// usage: bench_assistant [--ini AUG.ini] [Section.Key=Value | Key=Value ...]   run all scenarios, exit code 1 on any failure
+//        bench_assistant --serve [port] [tokens=N rate=N delay=S frag=N disconnect=N malformed=N]   standalone mock for AiBackendUrl
+// Keys without section go to [Assistant]. Runs offline, no model, no network.
+
+#include "Assistant.h"
+#include "MockAssistantServer.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+#if defined(_WIN32)
+	#include <windows.h>
+#else
+	#include <sys/resource.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+static double GetProcessCpuSeconds()
+{
+	#if defined(_WIN32)
+	FILETIME Creation, Exit, Kernel, User;
+	GetProcessTimes(GetCurrentProcess(), &Creation, &Exit, &Kernel, &User);
+	auto ToSeconds = [](const FILETIME& ft) { return (((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime) * 1e-7; };
+	return ToSeconds(Kernel) + ToSeconds(User);
+	#else
+	rusage Usage {};
+	getrusage(RUSAGE_SELF, &Usage);
+	return Usage.ru_utime.tv_sec + Usage.ru_stime.tv_sec + (Usage.ru_utime.tv_usec + Usage.ru_stime.tv_usec) * 1e-6;
+	#endif
+}
+
+static double Percentile(std::vector<double> Values, double P)
+{
+	if (Values.empty())
+		return 0;
+	std::sort(Values.begin(), Values.end());
+	const size_t Index = std::clamp((size_t)ceil(P * Values.size()), (size_t)1, Values.size()) - 1;
+	return Values[Index];
+}
+
+static double Seconds(Clock::time_point From, Clock::time_point To)
+{
+	return std::chrono::duration<double>(To - From).count();
+}
+
+// one request, filled by assistant thread
+struct Track
+{
+	std::mutex Mutex;
+	Clock::time_point Submit;
+	Clock::time_point Final;
+	Clock::time_point Cancel;
+	std::vector<Clock::time_point> Arrivals;
+	std::string Content; // accumulated deltas
+	std::atomic<int> NumDeltas {0};
+	std::atomic<bool> Done {false};
+	bool Failed = false;
+	bool Cancelled = false;
+	bool CancelSent = false;
+	int DeltasAfterCancel = 0;
+};
+
+struct Scenario
+{
+	const char* Name;
+	std::string Query; // mock server parameters
+	int Requests = 1; // submitted at once
+	int CancelAfter = -1; // deltas, -1 never
+	bool ExpectFailure = false;
+	bool Shared = false; // all requests identical, coalesced into one
+	int ServerRequests = -1; // expected backend hits, -1 don't care
+};
+
+static bool RunScenario(IAssistant* Assistant, MockAssistantServer& Server, const Scenario& Sc)
+{
+	MockStreamConfig Config;
+	Config.Parse(Sc.Query);
+	const std::string Expected = Config.Expected();
+
+	std::vector<std::unique_ptr<Track>> Tracks;
+	std::vector<IAssistant::RequestId> Ids;
+	const std::vector<IAssistant::Message> Messages { {"system", "You are a benchmark."}, {"user", Sc.Query} };
+	const uint64_t ServerRequests0 = Server.NumRequests;
+
+	const double Cpu0 = GetProcessCpuSeconds();
+	const auto Clock0 = Clock::now();
+
+	for (int i = 0; i < Sc.Requests; ++i)
+	{
+		auto T = std::make_unique<Track>();
+		Track* Tr = T.get();
+		Tracks.push_back(std::move(T));
+
+		IAssistant::RequestOptions Options;
+		Options.Url = Server.GetUrl() + "?" + Sc.Query + "&seed=" + std::to_string(Sc.Shared ? 1 : i + 1);
+		Options.Callback = [Tr](IAssistant::Result& Res)
+		{
+			const auto Now = Clock::now();
+			std::lock_guard<std::mutex> Lock(Tr->Mutex);
+			if (Res.Partial)
+			{
+				Tr->Arrivals.push_back(Now);
+				Tr->Content.append(Res.Content);
+				if (Tr->CancelSent)
+					Tr->DeltasAfterCancel++;
+				Tr->NumDeltas++;
+			}
+			else
+			{
+				Tr->Final = Now;
+				Tr->Failed = Res.Failed;
+				Tr->Cancelled = Res.Cancelled;
+				Tr->Done = true;
+			}
+		};
+
+		Tr->Submit = Clock::now();
+		Ids.push_back(Assistant->Process(Messages, Options));
+	}
+
+	const auto Deadline = Clock::now() + std::chrono::seconds(60);
+	for (size_t i = 0; i < Tracks.size(); ++i)
+	{
+		Track* Tr = Tracks[i].get();
+		while (!Tr->Done && Clock::now() < Deadline)
+		{
+			if (Sc.CancelAfter >= 0 && !Tr->CancelSent && Tr->NumDeltas >= Sc.CancelAfter)
+			{
+				{
+					std::lock_guard<std::mutex> Lock(Tr->Mutex);
+					Tr->CancelSent = true;
+					Tr->Cancel = Clock::now();
+				}
+				Assistant->CancelRequest(Ids[i]);
+			}
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+		}
+	}
+
+	const auto Clock1 = Clock::now();
+	const double Cpu1 = GetProcessCpuSeconds();
+	const int NumServerRequests = (int)(Server.NumRequests - ServerRequests0);
+
+	// collect
+	std::vector<double> Ttft, Gaps, CancelLatency;
+	size_t NumDeltas = 0;
+	std::string Error;
+
+	for (const auto& T : Tracks)
+	{
+		std::lock_guard<std::mutex> Lock(T->Mutex);
+		NumDeltas += T->Arrivals.size();
+
+		if (!T->Done)
+		{
+			Error = "timed out";
+			continue;
+		}
+		if (!T->Arrivals.empty())
+			Ttft.push_back(Seconds(T->Submit, T->Arrivals.front()));
+		for (size_t i = 1; i < T->Arrivals.size(); ++i)
+			Gaps.push_back(Seconds(T->Arrivals[i - 1], T->Arrivals[i]));
+		if (T->CancelSent)
+			CancelLatency.push_back(Seconds(T->Cancel, T->Final));
+
+		if (Sc.CancelAfter >= 0)
+		{
+			if (!T->Cancelled)
+				Error = "not cancelled";
+			else if (Expected.compare(0, T->Content.size(), T->Content) != 0)
+				Error = "content before cancel differs";
+		}
+		else if (Sc.ExpectFailure)
+		{
+			if (!T->Failed)
+				Error = "failure not reported";
+			else if (T->Content != Expected)
+				Error = "content before failure differs";
+		}
+		else
+		{
+			if (T->Failed || T->Cancelled)
+				Error = "request failed";
+			else if (T->Content != Expected)
+				Error = "content differs";
+		}
+	}
+
+	if (Sc.ServerRequests >= 0 && NumServerRequests != Sc.ServerRequests)
+		Error = "backend hit " + std::to_string(NumServerRequests) + " times";
+
+	const double Wall = Seconds(Clock0, Clock1);
+	double GapMean = 0, GapStd = 0;
+	if (!Gaps.empty())
+	{
+		GapMean = std::accumulate(Gaps.begin(), Gaps.end(), 0.0) / Gaps.size();
+		for (double g : Gaps)
+			GapStd += (g - GapMean) * (g - GapMean);
+		GapStd = sqrt(GapStd / Gaps.size());
+	}
+
+	printf("%-12s %-4s req %2d  deltas %6zu  wall %7.1f ms  ttft p50 %6.2f p95 %6.2f ms  gap %6.2f +- %5.2f p99 %6.2f ms  cpu/delta %5.2f us  %.0f deltas/s",
+		Sc.Name, Error.empty() ? "ok" : "FAIL", Sc.Requests, NumDeltas, Wall * 1e3,
+		Percentile(Ttft, 0.5) * 1e3, Percentile(Ttft, 0.95) * 1e3,
+		GapMean * 1e3, GapStd * 1e3, Percentile(Gaps, 0.99) * 1e3,
+		NumDeltas ? (Cpu1 - Cpu0) / NumDeltas * 1e6 : 0.0, NumDeltas / std::max(Wall, 1e-9));
+	if (!CancelLatency.empty())
+	{
+		int After = 0;
+		for (const auto& T : Tracks)
+			After += T->DeltasAfterCancel;
+		printf("  cancel p50 %.2f max %.2f ms (%d late deltas)", Percentile(CancelLatency, 0.5) * 1e3, Percentile(CancelLatency, 1.0) * 1e3, After);
+	}
+	if (!Error.empty())
+		printf("  <- %s", Error.c_str());
+	printf("\n");
+
+	return Error.empty();
+}
+
+static int Serve(int argc, char** argv)
+{
+	MockAssistantServer Server;
+	int Port = 8080;
+	for (int i = 2; i < argc; ++i)
+	{
+		if (strchr(argv[i], '='))
+			Server.Defaults.Parse(argv[i]);
+		else
+			Port = atoi(argv[i]);
+	}
+
+	if (!Server.Start(Port))
+	{
+		printf("failed to listen on %d\n", Port);
+		return 1;
+	}
+
+	printf("mock assistant at %s, ctrl+c to quit\n", Server.GetUrl().c_str());
+	for (;;)
+	{
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1 && strcmp(argv[1], "--serve") == 0)
+		return Serve(argc, argv);
+
+	IniFile Config;
+	Config.set("Assistant", "Prewarm", false); // ttft includes connect, like a cold app start
+	Config.set("Assistant", "CacheResponses", true);
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string Arg = argv[i];
+		if (Arg == "--ini" && i + 1 < argc)
+		{
+			Config.load(argv[++i]);
+		}
+		else if (const size_t Eq = Arg.find('='); Eq != std::string::npos)
+		{
+			std::string Key = Arg.substr(0, Eq);
+			std::string Section = "Assistant";
+			if (const size_t Dot = Key.find('.'); Dot != std::string::npos)
+			{
+				Section = Key.substr(0, Dot);
+				Key = Key.substr(Dot + 1);
+			}
+			Config.set(Section, Key, std::string_view(Arg).substr(Eq + 1));
+		}
+	}
+
+	MockAssistantServer Server;
+	if (!Server.Start())
+	{
+		printf("mock server failed to start\n");
+		return 1;
+	}
+
+	std::unique_ptr<IAssistant> Assistant(IAssistant::CreateInstance());
+	Assistant->Serialize(Config, false);
+	if (!Assistant->Init(Server.GetUrl(), "", [](IAssistant::Result&) {}))
+	{
+		printf("assistant init failed\n");
+		return 1;
+	}
+
+	const Scenario Scenarios[] = {
+		{ "paced", "tokens=200&rate=500" },
+		{ "burst", "tokens=20000" }, // whole response in one write, cpu is mostly parser
+		{ "frag", "tokens=2000&frag=7" }, // events split at random byte offsets
+		{ "frag1", "tokens=300&frag=1" }, // byte by byte
+		{ "malformed", "tokens=1000&malformed=7" },
+		{ "disconnect", "tokens=500&rate=2000&disconnect=100", 1, -1, true },
+		{ "cancel", "tokens=10000&rate=200", 1, 20 },
+		{ "cancel-burst", "tokens=200000&frag=4096", 1, 1000 },
+		{ "concurrent", "tokens=200&rate=400", 8 },
+		{ "delay", "tokens=50&rate=1000&delay=0.05" },
+		{ "coalesce", "tokens=200&rate=500&delay=0.02", 4, -1, false, true, 1 }, // 4 identical requests, one transfer
+		{ "cache-hit", "tokens=200&rate=500", 1, -1, false, false, 0 }, // same as paced, replayed
+	};
+
+	int Failed = 0;
+	for (const auto& Sc : Scenarios)
+	{
+		if (!RunScenario(Assistant.get(), Server, Sc))
+			Failed++;
+	}
+
+	const auto Stats = Assistant->GetStats();
+	Assistant->Release();
+	Server.Stop();
+
+	printf("\nscenarios        %zu\n", std::size(Scenarios));
+	printf("failed           %d\n", Failed);
+	printf("requests         %llu\n", (unsigned long long)Stats.Requests);
+	printf("server requests  %llu\n", (unsigned long long)Server.NumRequests.load());
+	printf("connections      %llu\n", (unsigned long long)Server.NumConnections.load());
+	printf("cache hits       %llu\n", (unsigned long long)Stats.CacheHits);
+	printf("coalesced        %llu\n", (unsigned long long)Stats.Coalesced);
+
+	return Failed ? 1 : 0;
+}
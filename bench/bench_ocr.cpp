@@ -0,0 +1,307 @@
+// Headless OCR: image files -> ImageScreenCapture -> TesseractImageToText, no desktop needed
+// usage: bench_ocr [--ini AUG.ini] [--repeat N] [Section.Key=Value | Key=Value ...] image.png|dir [...]
+// Reference text is image.txt next to the image (optional). Keys without section go to [ImageToText].
+// First pass on an image is cold, --repeat more passes see the unchanged "screen" (tile cache, CacheTiles=0 to measure without).
+
+#include "ImageToText.h"
+#include "ScreenCapture.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdio>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+
+#if defined(_WIN32)
+	#include <windows.h>
+	#include <psapi.h>
+#else
+	#include <sys/resource.h>
+#endif
+
+static double GetProcessCpuSeconds()
+{
+	#if defined(_WIN32)
+	FILETIME Creation, Exit, Kernel, User;
+	GetProcessTimes(GetCurrentProcess(), &Creation, &Exit, &Kernel, &User);
+	auto ToSeconds = [](const FILETIME& ft) { return (((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime) * 1e-7; };
+	return ToSeconds(Kernel) + ToSeconds(User);
+	#else
+	rusage Usage {};
+	getrusage(RUSAGE_SELF, &Usage);
+	return Usage.ru_utime.tv_sec + Usage.ru_stime.tv_sec + (Usage.ru_utime.tv_usec + Usage.ru_stime.tv_usec) * 1e-6;
+	#endif
+}
+
+static double GetPeakRssMegabytes()
+{
+	#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS Counters {};
+	GetProcessMemoryInfo(GetCurrentProcess(), &Counters, sizeof(Counters));
+	return Counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+	#else
+	rusage Usage {};
+	getrusage(RUSAGE_SELF, &Usage);
+	return Usage.ru_maxrss / 1024.0; // KB on linux
+	#endif
+}
+
+// whitespace runs count as one space, OCR line breaks vs reference wrapping is not an error
+static std::string NormalizeText(const std::string& Text)
+{
+	std::string Out;
+	for (char c : Text)
+	{
+		if (isspace((unsigned char)c))
+		{
+			if (!Out.empty() && Out.back() != ' ')
+				Out.push_back(' ');
+		}
+		else
+		{
+			Out.push_back(c);
+		}
+	}
+	if (!Out.empty() && Out.back() == ' ')
+		Out.pop_back();
+	return Out;
+}
+
+// byte level levenshtein
+static size_t EditDistance(const std::string& Ref, const std::string& Hyp)
+{
+	std::vector<size_t> Prev(Hyp.size() + 1), Cur(Hyp.size() + 1);
+	for (size_t j = 0; j <= Hyp.size(); ++j)
+		Prev[j] = j;
+
+	for (size_t i = 1; i <= Ref.size(); ++i)
+	{
+		Cur[0] = i;
+		for (size_t j = 1; j <= Hyp.size(); ++j)
+		{
+			const size_t Sub = Prev[j - 1] + (Ref[i - 1] == Hyp[j - 1] ? 0 : 1);
+			Cur[j] = std::min({ Sub, Prev[j] + 1, Cur[j - 1] + 1 });
+		}
+		std::swap(Prev, Cur);
+	}
+	return Prev[Hyp.size()];
+}
+
+static double Percentile(std::vector<double> Values, double P)
+{
+	if (Values.empty())
+		return 0;
+	std::sort(Values.begin(), Values.end());
+	const size_t Index = std::clamp((size_t)ceil(P * Values.size()), (size_t)1, Values.size()) - 1;
+	return Values[Index];
+}
+
+static bool ReadText(const std::filesystem::path& Path, std::string& Text)
+{
+	std::ifstream File(Path);
+	if (!File)
+		return false;
+	std::stringstream Stream;
+	Stream << File.rdbuf();
+	Text = Stream.str();
+	return true;
+}
+
+static bool IsImage(const std::filesystem::path& Path)
+{
+	std::string Ext = Path.extension().string();
+	std::transform(Ext.begin(), Ext.end(), Ext.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+	return Ext == ".png" || Ext == ".jpg" || Ext == ".jpeg" || Ext == ".bmp" || Ext == ".tif" || Ext == ".tiff" || Ext == ".webp";
+}
+
+// Process is async, result comes on the OCR thread
+class OcrWaiter
+{
+public:
+
+	void Deliver(IImageToText::Result& Res)
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		Text = std::move(Res.Text);
+		NumDetections = Res.Detections.size();
+		Done = true;
+		Cv.notify_all();
+	}
+
+	double Run(IImageToText& Ocr)
+	{
+		{
+			std::lock_guard<std::mutex> Lock(Mutex);
+			Done = false;
+		}
+		const auto Clock0 = std::chrono::high_resolution_clock::now();
+		Ocr.Process();
+		std::unique_lock<std::mutex> Lock(Mutex);
+		Cv.wait(Lock, [this]() { return Done; });
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - Clock0).count();
+	}
+
+	std::string Text;
+	size_t NumDetections = 0;
+
+private:
+
+	std::mutex Mutex;
+	std::condition_variable Cv;
+	bool Done = false;
+};
+
+struct ImageStats
+{
+	double ColdSeconds = 0;
+	size_t RefChars = 0;
+	size_t CharErrors = 0;
+	bool HasRef = false;
+};
+
+int main(int argc, char** argv)
+{
+	namespace fs = std::filesystem;
+
+	IniFile Config;
+	int Repeat = 3;
+	std::vector<std::string> Files;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string Arg = argv[i];
+		if (Arg == "--ini" && i + 1 < argc)
+		{
+			Config.load(argv[++i]);
+		}
+		else if (Arg == "--repeat" && i + 1 < argc)
+		{
+			Repeat = std::max(atoi(argv[++i]), 0);
+		}
+		else if (const size_t Eq = Arg.find('='); Eq != std::string::npos)
+		{
+			std::string Key = Arg.substr(0, Eq);
+			std::string Section = "ImageToText";
+			if (const size_t Dot = Key.find('.'); Dot != std::string::npos)
+			{
+				Section = Key.substr(0, Dot);
+				Key = Key.substr(Dot + 1);
+			}
+			Config.set(Section, Key, std::string_view(Arg).substr(Eq + 1));
+		}
+		else if (std::error_code Ec; fs::is_directory(Arg, Ec))
+		{
+			std::vector<std::string> DirFiles;
+			for (const auto& File : fs::directory_iterator(Arg, Ec))
+			{
+				if (File.is_regular_file(Ec) && IsImage(File.path()))
+					DirFiles.push_back(File.path().string());
+			}
+			std::sort(DirFiles.begin(), DirFiles.end());
+			Files.insert(Files.end(), DirFiles.begin(), DirFiles.end());
+		}
+		else
+		{
+			Files.push_back(Arg);
+		}
+	}
+
+	if (Files.empty())
+	{
+		printf("usage: bench_ocr [--ini AUG.ini] [--repeat N] [Section.Key=Value ...] image.png|dir [...]\n");
+		return 1;
+	}
+
+	// images go through the queue, one instance for the whole corpus like the app
+	IScreenCapture* Capture = IScreenCapture::CreateImageInstance();
+	std::unique_ptr<IImageToText> Ocr(IImageToText::CreateInstance(Capture));
+	Ocr->Serialize(Config, false);
+
+	OcrWaiter Waiter;
+	if (!Ocr->Init([&](IImageToText::Result& Res) { Waiter.Deliver(Res); }))
+	{
+		printf("init failed\n");
+		return 1;
+	}
+
+	// recognizers load on the OCR thread after Init, keep that out of the first image
+	const double Cpu0 = GetProcessCpuSeconds();
+	Capture->PushImage(cv::Mat(64, 64, CV_8UC3, cv::Scalar(255, 255, 255)));
+	const double WarmupSeconds = Waiter.Run(*Ocr);
+	const double Cpu1 = GetProcessCpuSeconds();
+
+	std::vector<double> ColdLatencies, CachedLatencies;
+	std::vector<ImageStats> Stats;
+
+	for (const auto& Filename : Files)
+	{
+		cv::Mat Image = cv::imread(Filename, cv::IMREAD_COLOR);
+		if (Image.empty() || !Capture->PushImage(Image))
+		{
+			printf("%s: failed to load\n", Filename.c_str());
+			return 1;
+		}
+
+		ImageStats Stat;
+		Stat.ColdSeconds = Waiter.Run(*Ocr);
+		const std::string Text = Waiter.Text;
+		const size_t NumLines = Waiter.NumDetections;
+
+		std::vector<double> FileCached;
+		for (int i = 0; i < Repeat; ++i)
+		{
+			FileCached.push_back(Waiter.Run(*Ocr)); // capture stays on the same image
+		}
+
+		std::string Reference;
+		if (ReadText(fs::path(Filename).replace_extension(".txt"), Reference))
+		{
+			const std::string Ref = NormalizeText(Reference);
+			Stat.HasRef = true;
+			Stat.RefChars = Ref.size();
+			Stat.CharErrors = EditDistance(Ref, NormalizeText(Text));
+		}
+
+		printf("%s: %dx%d, lines %zu, cold %.0f ms, cached p50 %.1f ms",
+			Filename.c_str(), Image.cols, Image.rows, NumLines, Stat.ColdSeconds * 1e3, Percentile(FileCached, 0.5) * 1e3);
+		if (Stat.HasRef)
+			printf(", CER %.1f%% (%zu/%zu)", 100.0 * Stat.CharErrors / std::max<size_t>(Stat.RefChars, 1), Stat.CharErrors, Stat.RefChars);
+		printf("\n");
+
+		ColdLatencies.push_back(Stat.ColdSeconds);
+		CachedLatencies.insert(CachedLatencies.end(), FileCached.begin(), FileCached.end());
+		Stats.push_back(Stat);
+	}
+
+	const double Cpu2 = GetProcessCpuSeconds();
+	Ocr->Release();
+
+	ImageStats Total;
+	for (const auto& Stat : Stats)
+	{
+		Total.ColdSeconds += Stat.ColdSeconds;
+		Total.RefChars += Stat.RefChars;
+		Total.CharErrors += Stat.CharErrors;
+		Total.HasRef |= Stat.HasRef;
+	}
+
+	printf("\nimages           %zu\n", Stats.size());
+	printf("warmup           %.0f ms, cpu %.2f s\n", WarmupSeconds * 1e3, Cpu1 - Cpu0);
+	printf("cold total       %.2f s\n", Total.ColdSeconds);
+	printf("cold p50         %.0f ms\n", Percentile(ColdLatencies, 0.50) * 1e3);
+	printf("cold p95         %.0f ms\n", Percentile(ColdLatencies, 0.95) * 1e3);
+	printf("cached p50       %.1f ms\n", Percentile(CachedLatencies, 0.50) * 1e3);
+	printf("cached p95       %.1f ms\n", Percentile(CachedLatencies, 0.95) * 1e3);
+	printf("cpu per image    %.2f s\n", (Cpu2 - Cpu1) / Stats.size());
+	printf("peak rss         %.0f MB\n", GetPeakRssMegabytes());
+	if (Total.HasRef)
+		printf("CER              %.2f%% (%zu/%zu)\n", 100.0 * Total.CharErrors / std::max<size_t>(Total.RefChars, 1), Total.CharErrors, Total.RefChars);
+
+	return 0;
+}
@@ -0,0 +1,308 @@
+// End to end speech to text: WAV replay -> recorder -> converter -> VAD -> segmentation -> whisper
+// usage: bench_stt [--ini AUG.ini] [--timeout S] [Section.Key=Value | Key=Value ...] file.wav [file2.wav ...]
+// Reference transcript is file.txt next to file.wav (optional). Keys without section go to [Speech].
+// Default RecorderFileSpeed=0 (as fast as decoder allows), set 1 to measure real time capture latency.
+// Replay and clocks start once the model is loaded, --timeout (seconds per file, model load included) fails a stuck pipeline.
+// DropPolicy defaults to Queue, any dropped segment fails the run (transcript would miss audio).
+
+#include "SpeechToText.h"
+#include "WaveCore.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+
+#if defined(_WIN32)
+	#include <windows.h>
+	#include <psapi.h>
+#else
+	#include <sys/resource.h>
+#endif
+
+static double GetProcessCpuSeconds()
+{
+	#if defined(_WIN32)
+	FILETIME Creation, Exit, Kernel, User;
+	GetProcessTimes(GetCurrentProcess(), &Creation, &Exit, &Kernel, &User);
+	auto ToSeconds = [](const FILETIME& ft) { return (((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime) * 1e-7; };
+	return ToSeconds(Kernel) + ToSeconds(User);
+	#else
+	rusage Usage {};
+	getrusage(RUSAGE_SELF, &Usage);
+	return Usage.ru_utime.tv_sec + Usage.ru_stime.tv_sec + (Usage.ru_utime.tv_usec + Usage.ru_stime.tv_usec) * 1e-6;
+	#endif
+}
+
+static double GetPeakRssMegabytes()
+{
+	#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS Counters {};
+	GetProcessMemoryInfo(GetCurrentProcess(), &Counters, sizeof(Counters));
+	return Counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+	#else
+	rusage Usage {};
+	getrusage(RUSAGE_SELF, &Usage);
+	return Usage.ru_maxrss / 1024.0; // KB on linux
+	#endif
+}
+
+static std::vector<std::string> SplitWords(const std::string& Text)
+{
+	std::vector<std::string> Words;
+	std::string Word;
+	for (char c : Text)
+	{
+		if (isalnum((unsigned char)c) || c == '\'' || (c & 0x80)) // keep utf8 bytes as word chars
+		{
+			Word.push_back((char)tolower((unsigned char)c));
+		}
+		else if (!Word.empty())
+		{
+			Words.push_back(std::move(Word));
+			Word.clear();
+		}
+	}
+	if (!Word.empty())
+		Words.push_back(std::move(Word));
+	return Words;
+}
+
+// word level levenshtein
+static size_t EditDistance(const std::vector<std::string>& Ref, const std::vector<std::string>& Hyp)
+{
+	std::vector<size_t> Prev(Hyp.size() + 1), Cur(Hyp.size() + 1);
+	for (size_t j = 0; j <= Hyp.size(); ++j)
+		Prev[j] = j;
+
+	for (size_t i = 1; i <= Ref.size(); ++i)
+	{
+		Cur[0] = i;
+		for (size_t j = 1; j <= Hyp.size(); ++j)
+		{
+			const size_t Sub = Prev[j - 1] + (Ref[i - 1] == Hyp[j - 1] ? 0 : 1);
+			Cur[j] = std::min({ Sub, Prev[j] + 1, Cur[j - 1] + 1 });
+		}
+		std::swap(Prev, Cur);
+	}
+	return Prev[Hyp.size()];
+}
+
+static double Percentile(std::vector<double> Values, double P)
+{
+	if (Values.empty())
+		return 0;
+	std::sort(Values.begin(), Values.end());
+	const size_t Index = std::clamp((size_t)ceil(P * Values.size()), (size_t)1, Values.size()) - 1;
+	return Values[Index];
+}
+
+static std::string FormatLatency(const std::vector<double>& Values, double P)
+{
+	if (Values.empty())
+		return "n/a";
+	return fmt::format("{:.0f} ms", Percentile(Values, P) * 1e3);
+}
+
+static bool ReadText(const std::filesystem::path& Path, std::string& Text)
+{
+	std::ifstream File(Path);
+	if (!File)
+		return false;
+	std::stringstream Stream;
+	Stream << File.rdbuf();
+	Text = Stream.str();
+	return true;
+}
+
+struct FileStats
+{
+	double AudioSeconds = 0;
+	double WallSeconds = 0;
+	double CpuSeconds = 0;
+	double DecodeSeconds = 0;
+	size_t RefWords = 0;
+	size_t WordErrors = 0;
+	uint64_t DroppedSegments = 0;
+	bool HasRef = false;
+};
+
+int main(int argc, char** argv)
+{
+	IniFile Config;
+	Config.set("Speech", "RecorderFileSpeed", 0.0f);
+	Config.set("Speech", "DropPolicy", std::string_view("Queue"));
+	float TimeoutSeconds = 600;
+	std::vector<std::string> Files;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string Arg = argv[i];
+		if (Arg == "--ini" && i + 1 < argc)
+		{
+			Config.load(argv[++i]);
+		}
+		else if (Arg == "--timeout" && i + 1 < argc)
+		{
+			TimeoutSeconds = std::max((float)atof(argv[++i]), 1.0f);
+		}
+		else if (const size_t Eq = Arg.find('='); Eq != std::string::npos)
+		{
+			std::string Key = Arg.substr(0, Eq);
+			std::string Section = "Speech";
+			if (const size_t Dot = Key.find('.'); Dot != std::string::npos)
+			{
+				Section = Key.substr(0, Dot);
+				Key = Key.substr(Dot + 1);
+			}
+			Config.set(Section, Key, std::string_view(Arg).substr(Eq + 1));
+		}
+		else
+		{
+			Files.push_back(Arg);
+		}
+	}
+
+	if (Files.empty())
+	{
+		printf("usage: bench_stt [--ini AUG.ini] [--timeout S] [Section.Key=Value ...] file.wav [file2.wav ...]\n");
+		return 1;
+	}
+
+	std::vector<double> Latencies;
+	std::vector<FileStats> Stats;
+
+	for (const auto& Filename : Files)
+	{
+		Config.set("Speech", "RecorderFile", std::string_view(Filename));
+
+		std::unique_ptr<ISpeechToText> Stt(ISpeechToText::CreateInstance());
+		Stt->Serialize(Config, false);
+
+		std::mutex ResultMutex;
+		std::string Transcript;
+		std::vector<double> FileLatencies;
+		uint64_t AudioEndPos = 0;
+		double DecodeSeconds = 0;
+
+		const bool Ready = Stt->Init([&](ISpeechToText::Result& Res)
+		{
+			const auto Now = std::chrono::high_resolution_clock::now();
+			std::lock_guard<std::mutex> Lock(ResultMutex);
+			Transcript.append(Res.Text);
+			DecodeSeconds += Res.DecodeDuration;
+			AudioEndPos = std::max(AudioEndPos, Res.AudioEndPos);
+			if (!Res.Text.empty())
+			{
+				FileLatencies.push_back(std::chrono::duration<double>(Now - Res.CaptureTime).count());
+			}
+		});
+
+		if (!Ready)
+		{
+			printf("%s: init failed\n", Filename.c_str());
+			return 1;
+		}
+
+		const auto Deadline = std::chrono::high_resolution_clock::now() + std::chrono::milliseconds((int64_t)(TimeoutSeconds * 1000));
+
+		// model loads in background, replay starts when it is ready, keep that out of wall and cpu time
+		while (Stt->GetModelStatus() == ISpeechToText::EModelStatus::Loading && std::chrono::high_resolution_clock::now() < Deadline)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		if (Stt->GetModelStatus() != ISpeechToText::EModelStatus::Ready)
+		{
+			printf("%s: model %s\n", Filename.c_str(), Stt->GetModelStatus() == ISpeechToText::EModelStatus::Failed ? "failed to load" : "load timed out");
+			exit(1);
+		}
+
+		const double Cpu0 = GetProcessCpuSeconds();
+		const auto Clock0 = std::chrono::high_resolution_clock::now();
+
+		while (!Stt->IsDrained())
+		{
+			if (std::chrono::high_resolution_clock::now() >= Deadline)
+			{
+				printf("%s: timed out after %.0f s\n", Filename.c_str(), TimeoutSeconds);
+				exit(1); // no Release, it would wait for the stuck pipeline
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+
+		const auto Clock1 = std::chrono::high_resolution_clock::now();
+		const double Cpu1 = GetProcessCpuSeconds();
+		const uint64_t DroppedSegments = Stt->GetNumDroppedSegments();
+		Stt->Release();
+
+		WaveFormat Format {};
+		TRawArray<uint8_t> Bytes;
+		LoadWave(Filename.c_str(), Format, Bytes);
+
+		FileStats Stat;
+		Stat.AudioSeconds = Format.BlockAlign ? (Bytes.size() / Format.BlockAlign) / (double)Format.SampleRate : 0;
+		Stat.WallSeconds = std::chrono::duration<double>(Clock1 - Clock0).count();
+		Stat.CpuSeconds = Cpu1 - Cpu0;
+		Stat.DecodeSeconds = DecodeSeconds;
+		Stat.DroppedSegments = DroppedSegments;
+
+		std::string Reference;
+		if (ReadText(std::filesystem::path(Filename).replace_extension(".txt"), Reference))
+		{
+			const auto RefWords = SplitWords(Reference);
+			Stat.HasRef = true;
+			Stat.RefWords = RefWords.size();
+			Stat.WordErrors = EditDistance(RefWords, SplitWords(Transcript));
+		}
+
+		printf("%s: audio %.1f s, wall %.1f s, decode RTF %.3f, cpu/audio %.2f, latency n %zu p50 %s p95 %s, dropped %llu",
+			Filename.c_str(), Stat.AudioSeconds, Stat.WallSeconds, Stat.DecodeSeconds / Stat.AudioSeconds, Stat.CpuSeconds / Stat.AudioSeconds,
+			FileLatencies.size(), FormatLatency(FileLatencies, 0.5).c_str(), FormatLatency(FileLatencies, 0.95).c_str(), (unsigned long long)Stat.DroppedSegments);
+		if (Stat.HasRef)
+			printf(", WER %.1f%% (%zu/%zu)", 100.0 * Stat.WordErrors / std::max<size_t>(Stat.RefWords, 1), Stat.WordErrors, Stat.RefWords);
+		printf("\n");
+
+		Latencies.insert(Latencies.end(), FileLatencies.begin(), FileLatencies.end());
+		Stats.push_back(Stat);
+	}
+
+	FileStats Total;
+	for (const auto& Stat : Stats)
+	{
+		Total.AudioSeconds += Stat.AudioSeconds;
+		Total.WallSeconds += Stat.WallSeconds;
+		Total.CpuSeconds += Stat.CpuSeconds;
+		Total.DecodeSeconds += Stat.DecodeSeconds;
+		Total.RefWords += Stat.RefWords;
+		Total.WordErrors += Stat.WordErrors;
+		Total.DroppedSegments += Stat.DroppedSegments;
+		Total.HasRef |= Stat.HasRef;
+	}
+
+	printf("\nfiles            %zu\n", Stats.size());
+	printf("audio            %.1f s\n", Total.AudioSeconds);
+	printf("wall RTF         %.3f\n", Total.WallSeconds / Total.AudioSeconds);
+	printf("decode RTF       %.3f\n", Total.DecodeSeconds / Total.AudioSeconds);
+	printf("cpu per audio s  %.2f s\n", Total.CpuSeconds / Total.AudioSeconds);
+	printf("latency samples  %zu\n", Latencies.size());
+	printf("latency p50      %s\n", FormatLatency(Latencies, 0.50).c_str());
+	printf("latency p95      %s\n", FormatLatency(Latencies, 0.95).c_str());
+	printf("latency p99      %s\n", FormatLatency(Latencies, 0.99).c_str());
+	printf("dropped segments %llu\n", (unsigned long long)Total.DroppedSegments);
+	printf("peak rss         %.0f MB\n", GetPeakRssMegabytes());
+	if (Total.HasRef)
+		printf("WER              %.2f%% (%zu/%zu)\n", 100.0 * Total.WordErrors / std::max<size_t>(Total.RefWords, 1), Total.WordErrors, Total.RefWords);
+
+	if (Total.DroppedSegments)
+	{
+		printf("FAILED: segments were dropped, WER and RTF are not comparable\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,135 @@
+// WaveCore kernels: every variant vs scalar reference, correctness + throughput
+
+#include "WaveCore.h"
+
+#include <cstdio>
+#include <cmath>
+#include <random>
+#include <chrono>
+
+static constexpr size_t NumSamples = 1 << 20;
+static constexpr int NumIters = 50;
+
+template<typename TFunc>
+static double MeasureMsps(TFunc&& Func, size_t NumProcessed)
+{
+	Func(); // warm up
+	const auto Clock0 = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < NumIters; ++i)
+	{
+		Func();
+	}
+	const auto Clock1 = std::chrono::high_resolution_clock::now();
+	const double Seconds = std::chrono::duration<double>(Clock1 - Clock0).count();
+	return (double)NumProcessed * NumIters / Seconds * 1e-6;
+}
+
+static double MaxError(const float* a, const float* b, size_t Count)
+{
+	double Err = 0;
+	for (size_t i = 0; i < Count; ++i)
+		Err = std::max(Err, (double)fabsf(a[i] - b[i]));
+	return Err;
+}
+
+static double MaxError(const int16_t* a, const int16_t* b, size_t Count)
+{
+	double Err = 0;
+	for (size_t i = 0; i < Count; ++i)
+		Err = std::max(Err, (double)std::abs(a[i] - b[i]));
+	return Err;
+}
+
+static void Report(const char* Kernel, const WaveKernels* Variant, double Err, double Msps, double RefMsps)
+{
+	printf("%-16s %-8s err=%-10.3g %9.1f Msamples/s  x%.2f\n", Kernel, Variant->Name, Err, Msps, Msps / RefMsps);
+}
+
+int main(int argc, char** argv)
+{
+	std::mt19937 Rng(1234);
+	std::uniform_real_distribution<float> Dist(-1.5f, 1.5f); // out of range on purpose, F32toS16 must saturate
+	std::uniform_int_distribution<int> ByteDist(0, 255);
+
+	TRawArray<float> F32; F32.resize(NumSamples * 8);
+	TRawArray<uint8_t> Bytes; Bytes.resize(NumSamples * 4);
+	for (size_t i = 0; i < F32.size(); ++i) F32[i] = Dist(Rng);
+	for (size_t i = 0; i < Bytes.size(); ++i) Bytes[i] = (uint8_t)ByteDist(Rng);
+
+	TRawArray<float> RefF32; RefF32.resize(NumSamples);
+	TRawArray<float> OutF32; OutF32.resize(NumSamples);
+	TRawArray<int16_t> RefS16; RefS16.resize(NumSamples);
+	TRawArray<int16_t> OutS16; OutS16.resize(NumSamples);
+
+	const auto Variants = GetSupportedWaveKernels();
+	const WaveKernels* Ref = Variants[0];
+	int Failed = 0;
+
+	auto Check = [&Failed](double Err, double Tolerance) { if (Err > Tolerance) { Failed++; printf("  ^^^ MISMATCH\n"); } };
+
+	for (const WaveKernels* Var : Variants)
+	{
+		const int16_t* S16 = (const int16_t*)Bytes.data();
+		const int32_t* S32 = (const int32_t*)Bytes.data();
+		const uint8_t* S24 = Bytes.data();
+		const float* Src = F32.data();
+
+		double RefMsps, Msps;
+
+		RefMsps = MeasureMsps([&] { Ref->S16toF32(S16, RefF32.data(), NumSamples); }, NumSamples);
+		Msps = MeasureMsps([&] { Var->S16toF32(S16, OutF32.data(), NumSamples); }, NumSamples);
+		Report("S16toF32", Var, MaxError(RefF32.data(), OutF32.data(), NumSamples), Msps, RefMsps);
+		Check(MaxError(RefF32.data(), OutF32.data(), NumSamples), 0.0);
+
+		RefMsps = MeasureMsps([&] { Ref->S24toF32(S24, RefF32.data(), NumSamples); }, NumSamples);
+		Msps = MeasureMsps([&] { Var->S24toF32(S24, OutF32.data(), NumSamples); }, NumSamples);
+		Report("S24toF32", Var, MaxError(RefF32.data(), OutF32.data(), NumSamples), Msps, RefMsps);
+		Check(MaxError(RefF32.data(), OutF32.data(), NumSamples), 0.0);
+
+		RefMsps = MeasureMsps([&] { Ref->S32toF32(S32, RefF32.data(), NumSamples); }, NumSamples);
+		Msps = MeasureMsps([&] { Var->S32toF32(S32, OutF32.data(), NumSamples); }, NumSamples);
+		Report("S32toF32", Var, MaxError(RefF32.data(), OutF32.data(), NumSamples), Msps, RefMsps);
+		Check(MaxError(RefF32.data(), OutF32.data(), NumSamples), 0.0);
+
+		RefMsps = MeasureMsps([&] { Ref->F32toS16(Src, RefS16.data(), NumSamples); }, NumSamples);
+		Msps = MeasureMsps([&] { Var->F32toS16(Src, OutS16.data(), NumSamples); }, NumSamples);
+		Report("F32toS16", Var, MaxError(RefS16.data(), OutS16.data(), NumSamples), Msps, RefMsps);
+		Check(MaxError(RefS16.data(), OutS16.data(), NumSamples), 0.0);
+
+		for (uint32_t NumChannels : {2u, 6u, 8u})
+		{
+			char Name[32];
+			snprintf(Name, sizeof(Name), "Downmix%u", NumChannels);
+			RefMsps = MeasureMsps([&] { Ref->Downmix(Src, RefF32.data(), NumSamples, NumChannels); }, NumSamples);
+			Msps = MeasureMsps([&] { Var->Downmix(Src, OutF32.data(), NumSamples, NumChannels); }, NumSamples);
+			Report(Name, Var, MaxError(RefF32.data(), OutF32.data(), NumSamples), Msps, RefMsps);
+			Check(MaxError(RefF32.data(), OutF32.data(), NumSamples), 1e-6);
+		}
+
+		volatile float SinkF = 0;
+		volatile size_t SinkN = 0;
+
+		const float RefSum = Ref->SumSquares(Src, NumSamples);
+		RefMsps = MeasureMsps([&] { SinkF = Ref->SumSquares(Src, NumSamples); }, NumSamples);
+		Msps = MeasureMsps([&] { SinkF = Var->SumSquares(Src, NumSamples); }, NumSamples);
+		const double SumErr = fabs(Var->SumSquares(Src, NumSamples) - RefSum) / RefSum; // summation order differs
+		Report("SumSquares", Var, SumErr, Msps, RefMsps);
+		Check(SumErr, 1e-3);
+
+		RefMsps = MeasureMsps([&] { SinkF = Ref->PeakAbs(Src, NumSamples); }, NumSamples);
+		Msps = MeasureMsps([&] { SinkF = Var->PeakAbs(Src, NumSamples); }, NumSamples);
+		Report("PeakAbs", Var, fabs(Var->PeakAbs(Src, NumSamples) - Ref->PeakAbs(Src, NumSamples)), Msps, RefMsps);
+		Check(fabs(Var->PeakAbs(Src, NumSamples) - Ref->PeakAbs(Src, NumSamples)), 0.0);
+
+		RefMsps = MeasureMsps([&] { SinkN = Ref->ZeroCrossings(Src, NumSamples); }, NumSamples);
+		Msps = MeasureMsps([&] { SinkN = Var->ZeroCrossings(Src, NumSamples); }, NumSamples);
+		const double ZcrErr = (double)Var->ZeroCrossings(Src, NumSamples) - (double)Ref->ZeroCrossings(Src, NumSamples);
+		Report("ZeroCrossings", Var, ZcrErr, Msps, RefMsps);
+		Check(fabs(ZcrErr), 0.0);
+
+		printf("\n");
+	}
+
+	printf("%s\n", Failed ? "FAILED" : "OK");
+	return Failed ? 1 : 0;
+}
@@ -76,7 +76,10 @@ int AUG::Run()
 		const auto Clock0 = std::chrono::high_resolution_clock::now();
 
 		Tick();
+		DrainAiStream();
 		ExecuteDeferredTasks();
+		UpdateSpeculation();
+		SyncAiView();
 
 		if (RenderEveryTick || GotEvent || PendingFrames > 0)
 		{
@@ -155,9 +158,17 @@ void AUG::Serialize(IniFile& Config, bool Save) // WE DONT NEED REFLECTION IN C+
 	INI_SERIALIZE_PROP("Assistant", AiBackendUrl);
 	INI_SERIALIZE_PROP("Assistant", AiBackendToken);
 	INI_SERIALIZE_PROP("Assistant", AiSystemPrompt);
+	INI_SERIALIZE_PROP("Assistant", AiSpeculation);
+	INI_SERIALIZE_PROP("Assistant", AiSpeculationDelay);
+
+	if (ImageProc)
+		ImageProc->Serialize(Config, Save);
 
 	if (SpeechProc)
 		SpeechProc->Serialize(Config, Save);
+
+	if (AiProc)
+		AiProc->Serialize(Config, Save);
 }
 
 void AUG::LoadStyle() // WE DONT NEED REFLECTION IN C++
@@ -395,6 +406,7 @@ void AUG::InitGui() // TODO: switch to DX11 backend
 	CodeWindow.reset(new TextEditor());
 	CodeWindow->SetReadOnlyEnabled(true);
 	CodeWindow->SetShowWhitespacesEnabled(false);
+	CodeWindow->SetShowMatchingBrackets(false); // rescans whole document on every change, transcript only grows
 	CodeWindow->SetPalette(TextEditor::GetDarkPalette());
 	CodeWindow->SetLanguage(TextEditor::Language::Cpp());
 	#if 0
@@ -459,29 +471,30 @@ void AUG::InitProcessors()
 		auto Res(std::move(ProcessorRes));
 		DeferTask([this, Res = std::move(Res)]() mutable
 		{
+			if (!Res.Segments.empty())
+				ScheduleSpeculation();
 			std::move(std::begin(Res.Segments), std::end(Res.Segments), std::back_inserter(SpeechSegments));
+			SpeechTentative = std::move(Res.Tentative);
 			MarkDirty();
 		});
 	}), "SpeechToText");
 	
+	// 256K of deltas is minutes of tokens, if GUI stalls longer the preview drops text, final message is complete anyway
+	GUARD_THROW(AiStream.init(256 * 1024, 4096), "AiStream");
+
 	GUARD_THROW(AiProc->Init(AiBackendUrl, AiBackendToken, [this](IAssistant::Result& ProcessorRes)
 	{
+		if (ProcessorRes.Partial) // delta, no locks no malloc
+		{
+			AiStream.write(ProcessorRes.Content.data(), ProcessorRes.Content.size());
+			return;
+		}
+
 		auto Res(std::move(ProcessorRes));
-		DeferTask([this, Res = std::move(Res)]() mutable
+		DeferTask([this, Res = std::move(Res)]() mutable // full message
 		{
-			if (Res.Partial) // delta
-			{
-				AiPartial.append(Res.Content);
-			}
-			else // full message
-			{
-				if (!Res.Content.empty())
-				{
-					AiMessages.emplace_back(IAssistant::Message { "assistant", std::move(Res.Content) });
-				}
-				AiPartial.clear();
-			}
-			UpdateAiMessages();
+			DrainAiStream(); // deltas written before this task was queued
+			CommitAiPartial(std::move(Res.Content));
 			MarkDirty();
 		});
 	}), "Assistant");
@@ -595,9 +608,12 @@ void AUG::ToggleMarkTextMode()
 	else
 	{
 		TextBoundsB = { (float)MouseX, (float)MouseY };
+		ImageRegion = GetRect(TextBoundsA, TextBoundsB);
 		if (ImageProc)
 		{
-			ImageProc->Process(GetRect(TextBoundsA, TextBoundsB));
+			ImageProc->Process(ImageRegion);
+			if (ImageProc->IsContinuous())
+				ImageProc->SetContinuous(true, ImageRegion); // watch new selection
 		}
 	}
 }
@@ -765,6 +781,12 @@ void AUG::RenderFrame()
 				ImageDetections.clear();
 				ImageText.clear();
 			}
+			ImGui::SameLine();
+			bool Watch = ImageProc->IsContinuous();
+			if (ImGui::Checkbox("Watch##WatchImage", &Watch))
+			{
+				ImageProc->SetContinuous(Watch, ImageRegion); // background OCR of changed lines
+			}
 		}
 		TextUnformattedWithWrap(ImageText.data(), ImageText.data() + ImageText.size());
 		ImGuiAutoScrollY();
@@ -790,8 +812,13 @@ void AUG::RenderFrame()
 						Text.append(SpeechSegments[id]);
 					}
 				}
+				if (SpeechSelection.Size == 0 && AiSpeculation > 0) // nothing selected, everything said since last question
+				{
+					Text = GetUnsentSpeech();
+				}
 				if (!Text.empty())
 				{
+					SpeechPromptStart = SpeechSegments.size();
 					AddPrompt(Text);
 					ProcessPrompt();
 				}
@@ -800,6 +827,9 @@ void AUG::RenderFrame()
 			if (ImGui::Button("Clear##ClearSpeech"))
 			{
 				SpeechSegments.clear();
+				SpeechTentative.clear();
+				SpeechPromptStart = 0;
+				CancelSpeculation();
 			}
 			ImGui::SameLine();
 			ImGui::Checkbox("Autoscroll##AutoscrollSpeech", &AutoscrollSpeech);
@@ -832,6 +862,12 @@ void AUG::RenderFrame()
 
 			SelIO = ImGui::EndMultiSelect();
 			SpeechSelection.ApplyRequests(SelIO);
+
+			if (!SpeechTentative.empty())
+			{
+				ImGui::TextDisabled("%s", SpeechTentative.c_str());
+			}
+
 			if (AutoscrollSpeech)
 			{
 				ImGuiAutoScrollY();
@@ -861,9 +897,16 @@ void AUG::RenderFrame()
 			{
 				AiMessages.clear();
 				UpdateAiMessages();
+				CancelSpeculation();
 			}
 			ImGui::SameLine();
 			ImGui::Checkbox("Autoscroll##AutoscrollAi", &AutoscrollAi);
+			const auto AiStats = AiProc->GetStats();
+			if (AiStats.PromptTokens > 0)
+			{
+				ImGui::SameLine();
+				ImGui::TextDisabled("KV reuse %.0f%% (%llu/%llu)", 100.0 * AiStats.CachedTokens / AiStats.PromptTokens, (unsigned long long)AiStats.CachedTokens, (unsigned long long)AiStats.PromptTokens);
+			}
 		}
 		ImGui::PushStyleColor(ImGuiCol_FrameBg, ImVec4(0, 0, 0, 0));
 		if (ImGui::BeginChild("##AIChild", ImVec2(0, 0), ImGuiChildFlags_FrameStyle))
@@ -954,40 +997,145 @@ void AUG::PresentFrame()
 
 void AUG::AddPrompt(std::string Prompt, bool Refresh)
 {
-	AiMessages.emplace_back(IAssistant::Message {"user", std::move(Prompt)});
-	if (Refresh)
-		UpdateAiMessages();
+	AddPrompt(std::move(Prompt), "user", Refresh);
 }
 
 void AUG::AddPrompt(std::string Prompt, std::string Role, bool Refresh)
 {
 	AiMessages.emplace_back(IAssistant::Message {std::move(Role), std::move(Prompt)});
 	if (Refresh)
-		UpdateAiMessages();
+		AppendAiMessage(AiMessages.back());
+	else
+		AiTranscriptStale = true;
 }
 
+// TRANSCRIPT IS APPEND ONLY: messages, then partial answer as the tail. Full rebuild only on clear or system prompt insert.
+
 void AUG::UpdateAiMessages()
 {
 	AiCombinedMessages.clear();
+	AiPartialOffset = std::string::npos;
+	AiTranscriptStale = false;
+	AiViewReset = true;
+
 	for (const auto& Msg : AiMessages)
 	{
-		AiCombinedMessages.append("\n<");
-		AiCombinedMessages.append(Msg.Role);
-		AiCombinedMessages.append(">\n");
-		AiCombinedMessages.append(Msg.Content);
-		AiCombinedMessages.append("\n");
+		AppendAiMessage(Msg);
 	}
 
 	if (!AiPartial.empty())
 	{
+		AppendAiPartial(AiPartial);
+	}
+}
+
+void AUG::AppendAiMessage(const IAssistant::Message& Msg)
+{
+	const bool HasPartial = (AiPartialOffset != std::string::npos);
+	if (HasPartial) // keep partial at the tail
+	{
+		TruncateAiMessages(AiPartialOffset);
+	}
+
+	AiCombinedMessages.append("\n<");
+	AiCombinedMessages.append(Msg.Role);
+	AiCombinedMessages.append(">\n");
+	AiCombinedMessages.append(Msg.Content);
+	AiCombinedMessages.append("\n");
+
+	if (HasPartial)
+	{
+		AppendAiPartial(AiPartial);
+	}
+}
+
+void AUG::AppendAiPartial(std::string_view Text)
+{
+	if (AiPartialOffset == std::string::npos)
+	{
+		AiPartialOffset = AiCombinedMessages.size();
 		AiCombinedMessages.append("\n<assistant>\n");
-		AiCombinedMessages.append(AiPartial);
+	}
+	AiCombinedMessages.append(Text);
+}
+
+void AUG::CommitAiPartial(std::string Content)
+{
+	if (AiPartialOffset != std::string::npos && !Content.empty() && Content == AiPartial) // streamed text is already there
+	{
+		AiCombinedMessages.append("\n");
+		AiPartialOffset = std::string::npos;
+		AiPartial.clear();
+		AiMessages.emplace_back(IAssistant::Message { "assistant", std::move(Content) });
+		return;
+	}
+
+	if (AiPartialOffset != std::string::npos)
+	{
+		TruncateAiMessages(AiPartialOffset);
+		AiPartialOffset = std::string::npos;
+	}
+	AiPartial.clear();
+
+	if (!Content.empty())
+	{
+		AiMessages.emplace_back(IAssistant::Message { "assistant", std::move(Content) });
+		AppendAiMessage(AiMessages.back());
+	}
+}
+
+void AUG::TruncateAiMessages(size_t Offset)
+{
+	AiCombinedMessages.resize(Offset);
+	if (AiViewSize > Offset)
+		AiViewReset = true;
+}
+
+void AUG::SyncAiView()
+{
+	if (AiTranscriptStale)
+	{
+		UpdateAiMessages();
 	}
 
 	#if (AUG_ENABLE_COLOR_EDITOR)
-	CodeWindow->SetText(AiCombinedMessages);
+	if (AiViewReset)
+	{
+		CodeWindow->SetText(AiCombinedMessages);
+	}
+	else if (AiViewSize < AiCombinedMessages.size())
+	{
+		CodeWindow->AppendText(std::string_view(AiCombinedMessages).substr(AiViewSize)); // only new lines get colorized
+	}
+	else
+	{
+		return;
+	}
 	CodeWindow->ScrollToLine(CodeWindow->GetLineCount(), TextEditor::Scroll::alignBottom);
 	#endif
+
+	AiViewSize = AiCombinedMessages.size();
+	AiViewReset = false;
+}
+
+void AUG::DrainAiStream()
+{
+	uint64_t ReadPos = AiStream.read_pos();
+	const uint64_t WritePos = AiStream.write_pos();
+	if (ReadPos == WritePos)
+		return;
+
+	while (ReadPos < WritePos)
+	{
+		const size_t Size = (size_t)std::min<uint64_t>(WritePos - ReadPos, AiStream.max_span());
+		const char* Text = AiStream.span(ReadPos, Size);
+		AiPartial.append(Text, Size);
+		AppendAiPartial(std::string_view(Text, Size));
+		ReadPos += Size;
+	}
+	AiStream.consume(ReadPos);
+
+	MarkDirty();
 }
 
 void AUG::ProcessPrompt()
@@ -1001,7 +1149,110 @@ void AUG::ProcessPrompt()
 		UpdateAiMessages();
 	}
 
-	AiProc->Process(AiMessages);
+	const bool Speculated = (SpecId && SpecMessages.size() == AiMessages.size() && std::equal(SpecMessages.begin(), SpecMessages.end(), AiMessages.begin(),
+		[](const IAssistant::Message& A, const IAssistant::Message& B) { return A.Role == B.Role && A.Content == B.Content; }));
+
+	if (Speculated && SpecDone) // answered before the question was asked
+	{
+		logi("Speculative answer used");
+		CommitAiPartial(std::move(SpecAnswer));
+		SpecId = 0;
+		CancelSpeculation();
+		MarkDirty();
+		return;
+	}
+
+	// still streaming: assistant thread joins the identical transfer and gets what streamed so far, anything else cancels it there
+	IAssistant::RequestOptions Options;
+	if (Speculated)
+	{
+		Options.Adopt = SpecId;
+		SpecId = 0;
+	}
+	CancelSpeculation();
+
+	AiProc->Process(AiMessages, std::move(Options));
+}
+
+// everything said since the last question, Assist sends the same text when nothing is selected
+std::string AUG::GetUnsentSpeech() const
+{
+	std::string Text;
+	Text.reserve(1024);
+	for (size_t id = SpeechPromptStart; id < SpeechSegments.size(); ++id)
+	{
+		Text.append(SpeechSegments[id]);
+	}
+	return Text;
+}
+
+void AUG::ScheduleSpeculation()
+{
+	if (AiSpeculation <= 0)
+		return;
+
+	SpecScheduled = true;
+	SpecDue = std::chrono::steady_clock::now() + std::chrono::milliseconds((int)(AiSpeculationDelay * 1000));
+}
+
+// speaker paused: submit what we have, previous speculation is cancelled (cheap, it is just a cancel range for the assistant thread)
+void AUG::UpdateSpeculation()
+{
+	if (!SpecScheduled || std::chrono::steady_clock::now() < SpecDue)
+		return;
+
+	SpecScheduled = false;
+
+	std::string Text = GetUnsentSpeech();
+	if (Text.empty())
+		return;
+
+	// exactly what ProcessPrompt would send after Assist
+	std::vector<IAssistant::Message> Messages;
+	Messages.reserve(AiMessages.size() + 2);
+	if ((AiMessages.empty() || AiMessages[0].Role != "system") && !AiSystemPrompt.empty())
+	{
+		Messages.emplace_back(IAssistant::Message { "system", AiSystemPrompt });
+	}
+	Messages.insert(Messages.end(), AiMessages.begin(), AiMessages.end());
+	Messages.emplace_back(IAssistant::Message { "user", std::move(Text) });
+
+	CancelSpeculation();
+
+	IAssistant::RequestOptions Options;
+	if (AiSpeculation == 1)
+	{
+		Options.MaxTokens = 1; // prompt evaluation only, answer is thrown away
+	}
+	Options.Callback = [this, Keep = (AiSpeculation >= 2)](IAssistant::Result& ProcessorRes)
+	{
+		if (ProcessorRes.Partial || !Keep || ProcessorRes.Failed || ProcessorRes.Cancelled)
+			return;
+
+		DeferTask([this, Id = ProcessorRes.Id, Content = std::move(ProcessorRes.Content)]() mutable
+		{
+			if (Id == SpecId)
+			{
+				SpecAnswer = std::move(Content);
+				SpecDone = true;
+			}
+		});
+	};
+
+	SpecMessages = std::move(Messages);
+	SpecId = AiProc->Process(SpecMessages, std::move(Options));
+}
+
+void AUG::CancelSpeculation()
+{
+	if (SpecId)
+	{
+		AiProc->CancelRequest(SpecId);
+	}
+	SpecId = 0;
+	SpecDone = false;
+	SpecAnswer.clear();
+	SpecMessages.clear();
 }
 
 //=================================================================================================
@@ -15,6 +15,7 @@
 #include "ImageToText.h"
 #include "SpeechToText.h"
 #include "Assistant.h"
+#include "RingBuffer.h"
 
 #include <mutex>
 #include <future>
@@ -52,8 +53,19 @@ protected:
 	void AddPrompt(std::string Prompt, bool Refresh = true);
 	void AddPrompt(std::string Prompt, std::string Role, bool Refresh = true);
 	void UpdateAiMessages();
+	void AppendAiMessage(const IAssistant::Message& Msg);
+	void AppendAiPartial(std::string_view Text);
+	void CommitAiPartial(std::string Content);
+	void TruncateAiMessages(size_t Offset);
+	void SyncAiView();
+	void DrainAiStream();
 	void ProcessPrompt();
 
+	std::string GetUnsentSpeech() const;
+	void ScheduleSpeculation();
+	void UpdateSpeculation();
+	void CancelSpeculation();
+
 	void ReadKeyState();
 	bool IsKeyDown(int vkey) const;
 	bool WasKeyPressed(int vkey) const;
@@ -93,6 +105,8 @@ protected:
 	std::string AiBackendUrl = "http://127.0.0.1:8080/v1/chat/completions";
 	std::string AiBackendToken;
 	std::string AiSystemPrompt;
+	int AiSpeculation = 0; // while speaker talks: 0 off, 1 pre-submit transcript to warm server prompt cache, 2 also generate answer ahead
+	float AiSpeculationDelay = 0.3f; // seconds without new segment before (re)submit
 
 	std::mutex DeferredTasksMux;
 	std::queue<std::packaged_task<void()>> DeferredTasks;
@@ -165,13 +179,30 @@ protected:
 
 	std::vector<IImageToText::Detection> ImageDetections;
 	std::string ImageText;
+	IntRect ImageRegion {}; // last selection, continuous OCR watches it
 
 	std::vector<std::string> SpeechSegments;
+	std::string SpeechTentative;
 	ImGuiSelectionBasicStorage SpeechSelection;
+	size_t SpeechPromptStart = 0; // segments before this were already asked
 	
 	std::vector<IAssistant::Message> AiMessages;
 	std::string AiPartial;
-	std::string AiCombinedMessages;
+	std::string AiCombinedMessages; // transcript, see UpdateAiMessages
+	size_t AiPartialOffset = std::string::npos; // start of streamed answer, always the tail
+	size_t AiViewSize = 0; // transcript bytes already in CodeWindow
+	bool AiViewReset = true; // CodeWindow needs full SetText
+	bool AiTranscriptStale = false;
+	TRingBuffer<char> AiStream; // deltas from assistant thread, drained once per tick
+
+	// speculative request for AiMessages + unsent speech, restarted when speech grows
+	std::vector<IAssistant::Message> SpecMessages;
+	IAssistant::RequestId SpecId = 0;
+	std::chrono::steady_clock::time_point SpecDue;
+	bool SpecScheduled = false;
+	bool SpecDone = false; // SpecAnswer is complete
+	std::string SpecAnswer;
+
 
 	std::unique_ptr<IImageToText> ImageProc;
 	std::unique_ptr<ISpeechToText> SpeechProc;
@@ -1,7 +1,8 @@
 #include "Assistant.h"
+#include "ResponseCache.h"
 
-#include <BS_thread_pool.hpp>
 #include <curl/curl.h>
+#include <xxh3.h>
 
 #pragma warning(push, 1)
 // GENERATES OVER 9000 WARNINGS, PROB UNIX STYLE :D
@@ -10,6 +11,131 @@
 #include <rapidjson/writer.h>
 #pragma warning(pop)
 
+#include <string_view>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <chrono>
+
+// Server-Sent Events framer: lines end with \n, \r\n or \r, fields are "name: value", empty line ends the event.
+// Lines split across reads are buffered, several events per read are fine. Buffers keep their capacity.
+class SseFramer
+{
+public:
+
+	void Reset()
+	{
+		Line.clear();
+		Data.clear();
+		Event.clear();
+		HasData = false;
+		SkipLF = false;
+	}
+
+	// OnEvent(std::string_view Event, std::string& Data), Data is mutable and only valid during the call
+	template<typename F>
+	void Feed(const char* Ptr, size_t Size, F&& OnEvent)
+	{
+		size_t Pos = 0;
+		if (SkipLF && Size && Ptr[0] == '\n') // \r\n split between reads
+			Pos = 1;
+		SkipLF = false;
+
+		size_t Start = Pos;
+		for (; Pos < Size; ++Pos)
+		{
+			const char c = Ptr[Pos];
+			if (c != '\n' && c != '\r')
+				continue;
+
+			if (Line.empty()) // whole line is in this read, no copy
+			{
+				ProcessLine(Ptr + Start, Pos - Start, OnEvent);
+			}
+			else
+			{
+				Line.append(Ptr + Start, Pos - Start);
+				ProcessLine(Line.data(), Line.size(), OnEvent);
+				Line.clear();
+			}
+
+			if (c == '\r')
+			{
+				if (Pos + 1 == Size)
+					SkipLF = true;
+				else if (Ptr[Pos + 1] == '\n')
+					++Pos;
+			}
+
+			Start = Pos + 1;
+		}
+
+		Line.append(Ptr + Start, Size - Start);
+	}
+
+	// stream closed, dispatch whatever is left even without trailing empty line
+	template<typename F>
+	void Finish(F&& OnEvent)
+	{
+		if (!Line.empty())
+		{
+			ProcessLine(Line.data(), Line.size(), OnEvent);
+			Line.clear();
+		}
+		ProcessLine(nullptr, 0, OnEvent);
+	}
+
+private:
+
+	template<typename F>
+	void ProcessLine(const char* Ptr, size_t Size, F& OnEvent)
+	{
+		if (!Size) // dispatch
+		{
+			if (HasData)
+				OnEvent(std::string_view(Event), Data);
+			Data.clear();
+			Event.clear();
+			HasData = false;
+			return;
+		}
+
+		if (Ptr[0] == ':') // comment, keepalive
+			return;
+
+		const char* Colon = (const char*)memchr(Ptr, ':', Size);
+		const std::string_view Field(Ptr, Colon ? (size_t)(Colon - Ptr) : Size);
+		std::string_view Value;
+		if (Colon)
+		{
+			Value = std::string_view(Colon + 1, Size - (size_t)(Colon + 1 - Ptr));
+			if (!Value.empty() && Value[0] == ' ')
+				Value.remove_prefix(1);
+		}
+
+		if (Field == "data")
+		{
+			if (HasData)
+				Data.push_back('\n');
+			Data.append(Value);
+			HasData = true;
+		}
+		else if (Field == "event")
+		{
+			Event.assign(Value);
+		}
+		// id, retry: not interested
+	}
+
+	std::string Line;
+	std::string Data;
+	std::string Event;
+	bool HasData = false;
+	bool SkipLF = false;
+};
+
 class OpenAIAssistant : public IAssistant
 {
 public:
@@ -17,26 +143,87 @@ public:
 	virtual ~OpenAIAssistant() override { Release(); }
 	virtual bool Init(std::string Url, std::string Token, ResultCallback Callback) override;
 	virtual void Release() override;
-	virtual void Process(std::vector<Message> Messages) override;
+	virtual void Serialize(IniFile& Config, bool Save) override;
+	virtual RequestId Process(std::vector<Message> Messages, RequestOptions Options) override;
+	virtual void CancelRequest(RequestId Id) override;
 	virtual void CancelCurrentRequest() override;
 	virtual void CancelAllRequests() override;
+	virtual Stats GetStats() const override;
 
 private:
 
-	std::string GenerateJson(const std::vector<Message>& Messages);
-	void SendRequest(const std::string& RequestData, Result& Res);
+	using CurlPtr = std::unique_ptr<CURL, decltype([] (CURL* ptr) { curl_easy_cleanup(ptr); })>;
+	using CurlListPtr = std::unique_ptr<curl_slist, decltype([] (curl_slist* ptr) { curl_slist_free_all(ptr); })>;
+	using CurlMultiPtr = std::unique_ptr<CURLM, decltype([] (CURLM* ptr) { curl_multi_cleanup(ptr); })>;
 
-	struct CurlContext { OpenAIAssistant* Solver; Result* Res; std::string Message; };
-	size_t WriteCallback(char *ptr, size_t size, size_t nmemb, CurlContext* context);
-	static size_t CurlWriteCallback(char *ptr, size_t size, size_t nmemb, CurlContext* userdata)
+	struct Request
 	{
-		return userdata->Solver->WriteCallback(ptr, size, nmemb, userdata);
-	}
+		OpenAIAssistant* Solver = nullptr;
+		RequestId Id = 0;
+		std::vector<Message> Messages;
+		RequestOptions Options;
+		CurlListPtr Headers; // own headers when Options.Url is set
+		CurlPtr Curl;
+		std::unique_ptr<rapidjson::StringBuffer> Body; // request json, from BodyPool, curl reads it in place
+		Result Res;
+		std::string FullMessage; // accumulated deltas
+		SseFramer Framer;
+		std::string Response; // not an event-stream, plain json response or error
+		int Mode = 0; // 0 unknown, 1 event-stream, 2 plain
+		bool Done = false; // [DONE] seen
+		bool Prewarm = false;
+		int SlotId = -1;
+		std::string SessionKey; // backend url + slot
+		std::vector<uint64_t> MessageHashes;
+		std::string Url; // effective backend
+		uint64_t CacheKey = 0; // url + body hash, same key same answer
+		std::vector<uint32_t> DeltaEnds; // FullMessage size after each delta, kept for replay
+		std::vector<std::unique_ptr<Request>> Followers; // identical requests riding on this transfer
+		bool Detached = false; // own caller cancelled, transfer goes on for followers
+		ResponseCache::EntryPtr Replay; // answered from cache
+		size_t ReplayDelta = 0;
+		std::chrono::steady_clock::time_point ReplayStart;
+	};
 
-	int ProgressCallback(CurlContext* clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow);
-	static int CurlProgressCallback(CurlContext* clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
+	// what the server holds in its KV cache per backend/slot, as far as we know
+	struct Session
 	{
-		return clientp->Solver->ProgressCallback(clientp, dltotal, dlnow, ultotal, ulnow);
+		std::vector<uint64_t> MessageHashes; // last prompt + its answer
+	};
+	static uint64_t HashMessage(std::string_view Role, std::string_view Content);
+	void UpdatePrefix(Request* Req);
+	void CommitPrefix(Request* Req);
+
+	curl_slist* CreateHeaders(const std::string& Token);
+	struct ModelParams;
+	void GenerateJson(const std::vector<Message>& Messages, const ModelParams& Params, int SlotId, int NumTokens, rapidjson::StringBuffer& Buffer);
+	void PublishParams();
+	void RecycleRequest(Request* Req);
+	void PrepareRequest(Request* Req);
+	bool ReplayRequest(std::unique_ptr<Request>& Req);
+	bool JoinRequest(std::unique_ptr<Request>& Req);
+	Request* FindAdopted(const Request* Req);
+	void ForgetRequest(Request* Req);
+	void StoreResponse(Request* Req, CURL* Handle);
+	bool CancelSubscribers(Request* Req, RequestId FirstId, RequestId LastId);
+
+	// assistant thread
+	void RunLoop();
+	void AcceptRequests();
+	void StartRequest(std::unique_ptr<Request> Req);
+	void FinishRequest(CURL* Handle, CURLcode Error);
+	void CancelActive(RequestId FirstId, RequestId LastId);
+	void PumpReplays();
+	void Deliver(Request* Req);
+	void DeliverOwn(Request* Req);
+	void SetupConnection(CURL* Handle);
+
+	void HandleEvent(Request* Req, std::string_view Event, std::string& Data);
+	void HandleJson(Request* Req, char* Json);
+	size_t WriteCallback(char *ptr, size_t size, size_t nmemb, Request* Req);
+	static size_t CurlWriteCallback(char *ptr, size_t size, size_t nmemb, Request* userdata)
+	{
+		return userdata->Solver->WriteCallback(ptr, size, nmemb, userdata);
 	}
 
 private:
@@ -45,12 +232,84 @@ private:
 	std::string BackendToken;
 	ResultCallback ResCallback;
 
-	std::atomic<int> CancelRequestFlag;
+	// connection, options are applied once per handle and the connection cache of the multi handle is reused between requests
+	bool UseHttp2 = false; // h2c prior knowledge for http://, ALPN for https://
+	bool Prewarm = true; // connect (and TLS handshake) in Init instead of on first prompt
+	int KeepAliveIdle = 30; // seconds before TCP keepalive probes, 0 off
+	int ConnectTimeout = 10;
+	int MaxConnectionAge = 3600; // seconds an idle cached connection may be reused
+	int MaxRequests = 4; // running at once, rest waits
+	float RequestTimeout = 0; // seconds, 0 no limit
+
+	// model parameters, omitted from request when empty/negative so server defaults apply
+	std::string Model;
+	float Temperature = -1;
+	int MaxTokens = 0;
+	int Seed = -1;
+	std::string Stop; // stop sequences separated by |
+
+	// prompt cache, llama.cpp server extensions (OpenAI rejects unknown fields, so off by default)
+	bool CachePrompt = false; // send cache_prompt, server reuses KV of the common prompt prefix
+	int SlotId = -1; // pin conversation to a server slot (id_slot) so other clients don't evict it, -1 any
+	bool RequestUsage = false; // stream_options.include_usage, OpenAI sends prompt/cached tokens only when asked (llama.cpp has timings anyway)
+
+	// copy of the above for the assistant thread, Serialize may run on UI thread while bodies are built
+	struct ModelParams
+	{
+		std::string Model;
+		float Temperature = -1;
+		int MaxTokens = 0;
+		int Seed = -1;
+		std::vector<std::string> StopList;
+		bool CachePrompt = false;
+		int SlotId = -1;
+		bool RequestUsage = false;
+	};
+	std::shared_ptr<const ModelParams> PublishedParams; // replaced as a whole under ParamsMutex, never modified
+	std::mutex ParamsMutex;
+
+	// same url + request body (prompt and model params) is answered locally, repeat clicks cost nothing
+	bool CacheResponses = false;
+	bool CoalesceRequests = true; // identical request in flight is shared, not sent twice
+	int CacheEntries = 64;
+	int CacheMemoryMB = 16;
+	std::string CacheDir; // empty: memory only
+	int CacheDiskMB = 64;
+	float ReplayRate = 0; // cached deltas per second, 0 all at once
+
+	CurlListPtr Headers;
+	CurlMultiPtr Multi;
+	std::thread LoopThread;
+	std::atomic<int> StopFlag {0};
+	std::atomic<RequestId> NextId {1};
+
+	// submitted from any thread, picked up by the loop
+	std::mutex QueueMutex;
+	std::vector<std::unique_ptr<Request>> Submitted;
+	std::vector<std::pair<RequestId, RequestId>> CancelRanges;
 
-	std::unique_ptr<CURL, decltype([] (CURL* ptr) { curl_easy_cleanup(ptr); })> Curl;
-	std::unique_ptr<curl_slist, decltype([] (curl_slist* ptr) { curl_slist_free_all(ptr); })> Headers;
+	// assistant thread only
+	std::map<RequestId, std::unique_ptr<Request>> Active;
+	std::deque<std::unique_ptr<Request>> Waiting;
+	std::vector<CurlPtr> IdleHandles;
+	std::vector<std::unique_ptr<rapidjson::StringBuffer>> BodyPool;
+	rapidjson::Writer<rapidjson::StringBuffer> JsonWriter;
+	std::map<std::string, Session> Sessions;
+	std::unordered_map<uint64_t, Request*> InFlight; // leaders by CacheKey, waiting or active
+	std::vector<std::unique_ptr<Request>> Replays;
+	ResponseCache Responses;
 
-	std::unique_ptr<BS::thread_pool<BS::tp::none>> ThreadPool;
+	mutable std::mutex StatsMutex;
+	Stats CurStats;
+
+	// per event json goes here, reset before each parse
+	using PoolAllocator = rapidjson::MemoryPoolAllocator<>;
+	using PoolDocument = rapidjson::GenericDocument<rapidjson::UTF8<>, PoolAllocator, PoolAllocator>;
+	static constexpr size_t JsonStackCapacity = 1024;
+	alignas(8) char JsonValueBuffer[32 * 1024];
+	alignas(8) char JsonStackBuffer[4 * 1024];
+	PoolAllocator JsonValueAllocator {JsonValueBuffer, sizeof(JsonValueBuffer)};
+	PoolAllocator JsonStackAllocator {JsonStackBuffer, sizeof(JsonStackBuffer)};
 };
 
 bool OpenAIAssistant::Init(std::string Url, std::string Token, ResultCallback Callback)
@@ -63,23 +322,29 @@ bool OpenAIAssistant::Init(std::string Url, std::string Token, ResultCallback Ca
 
 		GUARD_BREAK(!BackendUrl.empty(), "Invalid backend url");
 
-		curl_slist* TmpHeaders = nullptr;
-		TmpHeaders = curl_slist_append(TmpHeaders, "Content-Type: application/json");
-		TmpHeaders = curl_slist_append(TmpHeaders,  "Accept: text/event-stream");
-		if (!BackendToken.empty())
+		Headers.reset(CreateHeaders(BackendToken));
+		GUARD_BREAK(Headers.get(), "curl_slist_append");
+
+		Multi.reset(curl_multi_init());
+		GUARD_BREAK(Multi.get(), "curl_multi_init");
+
+		if (CacheResponses)
 		{
-			std::string AuthString("Authorization: Bearer ");
-			AuthString.append(BackendToken);
-			TmpHeaders = curl_slist_append(TmpHeaders, AuthString.c_str());
+			Responses.Init((size_t)CacheEntries, (size_t)CacheMemoryMB << 20, CacheDir, (size_t)CacheDiskMB << 20);
 		}
 
-		GUARD_BREAK(TmpHeaders, "curl_slist_append");
-		Headers.reset(TmpHeaders);
+		PublishParams(); // Serialize is optional
+		StopFlag = 0;
+		LoopThread = std::thread(&OpenAIAssistant::RunLoop, this);
 
-		Curl.reset(curl_easy_init());
-		GUARD_BREAK(Curl.get(), "curl_easy_init");
-
-		ThreadPool.reset(new BS::thread_pool(1)); // don't change
+		if (Prewarm) // HEAD to backend url, status code doesn't matter, connection stays in the cache
+		{
+			auto Req = std::make_unique<Request>();
+			Req->Solver = this;
+			Req->Prewarm = true;
+			std::lock_guard<std::mutex> Lock(QueueMutex);
+			Submitted.push_back(std::move(Req));
+		}
 
 		return true;
 	}
@@ -91,177 +356,951 @@ bool OpenAIAssistant::Init(std::string Url, std::string Token, ResultCallback Ca
 
 void OpenAIAssistant::Release()
 {
-	if (ThreadPool) { logi("OpenAIAssistant::Release"); }
+	if (LoopThread.joinable())
+	{
+		logi("OpenAIAssistant::Release");
+		StopFlag = 1;
+		curl_multi_wakeup(Multi.get());
+		LoopThread.join();
+	}
 
-	ResCallback = {};
-	ThreadPool.reset();
+	Submitted.clear();
+	CancelRanges.clear();
+	Waiting.clear();
+	IdleHandles.clear();
+	BodyPool.clear();
+	InFlight.clear();
+	Replays.clear();
+	Responses.Release();
+	Multi.reset();
 	Headers.reset();
-	Curl.reset();
+	ResCallback = {};
+}
+
+void OpenAIAssistant::Serialize(IniFile& Config, bool Save)
+{
+	INI_SERIALIZE_PROP("Assistant", UseHttp2);
+	INI_SERIALIZE_PROP("Assistant", Prewarm);
+	INI_SERIALIZE_PROP("Assistant", KeepAliveIdle);
+	INI_SERIALIZE_PROP("Assistant", ConnectTimeout);
+	INI_SERIALIZE_PROP("Assistant", MaxConnectionAge);
+	INI_SERIALIZE_PROP("Assistant", MaxRequests);
+	INI_SERIALIZE_PROP("Assistant", RequestTimeout);
+	INI_SERIALIZE_PROP("Assistant", CachePrompt);
+	INI_SERIALIZE_PROP("Assistant", SlotId);
+	INI_SERIALIZE_PROP("Assistant", RequestUsage);
+	INI_SERIALIZE_PROP("Assistant", Model);
+	INI_SERIALIZE_PROP("Assistant", Temperature);
+	INI_SERIALIZE_PROP("Assistant", MaxTokens);
+	INI_SERIALIZE_PROP("Assistant", Seed);
+	INI_SERIALIZE_PROP("Assistant", Stop);
+	INI_SERIALIZE_PROP("Assistant", CacheResponses);
+	INI_SERIALIZE_PROP("Assistant", CoalesceRequests);
+	INI_SERIALIZE_PROP("Assistant", CacheEntries);
+	INI_SERIALIZE_PROP("Assistant", CacheMemoryMB);
+	INI_SERIALIZE_PROP("Assistant", CacheDir);
+	INI_SERIALIZE_PROP("Assistant", CacheDiskMB);
+	INI_SERIALIZE_PROP("Assistant", ReplayRate);
+
+	if (!Save)
+	{
+		PublishParams();
+	}
+}
+
+void OpenAIAssistant::PublishParams()
+{
+	auto NewParams = std::make_shared<ModelParams>();
+	NewParams->Model = Model;
+	NewParams->Temperature = Temperature;
+	NewParams->MaxTokens = MaxTokens;
+	NewParams->Seed = Seed;
+	NewParams->CachePrompt = CachePrompt;
+	NewParams->SlotId = SlotId;
+	NewParams->RequestUsage = RequestUsage;
+	for (size_t Pos = 0; Pos <= Stop.size() && !Stop.empty(); )
+	{
+		const size_t Next = std::min(Stop.find('|', Pos), Stop.size());
+		if (Next > Pos)
+			NewParams->StopList.emplace_back(Stop.substr(Pos, Next - Pos));
+		Pos = Next + 1;
+	}
+
+	std::lock_guard<std::mutex> Lock(ParamsMutex);
+	PublishedParams = std::move(NewParams);
+}
+
+curl_slist* OpenAIAssistant::CreateHeaders(const std::string& Token)
+{
+	curl_slist* TmpHeaders = nullptr;
+	TmpHeaders = curl_slist_append(TmpHeaders, "Content-Type: application/json");
+	TmpHeaders = curl_slist_append(TmpHeaders,  "Accept: text/event-stream");
+	if (!Token.empty())
+	{
+		std::string AuthString("Authorization: Bearer ");
+		AuthString.append(Token);
+		TmpHeaders = curl_slist_append(TmpHeaders, AuthString.c_str());
+	}
+	return TmpHeaders;
 }
 
-void OpenAIAssistant::Process(std::vector<Message> Messages)
+IAssistant::RequestId OpenAIAssistant::Process(std::vector<Message> Messages, RequestOptions Options)
 {
 	if (Messages.empty())
-		return;
+		return 0;
 
-	if (!ThreadPool || !ResCallback)
-		return;
+	if (!LoopThread.joinable() || (!ResCallback && !Options.Callback))
+		return 0;
+
+	auto Req = std::make_unique<Request>();
+	Req->Solver = this;
+	Req->Id = NextId++;
+	Req->Res.Id = Req->Id;
+	Req->Messages = std::move(Messages);
+	Req->Options = std::move(Options);
 
-	CancelRequestFlag = 0;
+	if (!Req->Options.Url.empty()) // other backend, don't leak our token there
+	{
+		Req->Headers.reset(CreateHeaders(Req->Options.Token));
+		if (!Req->Headers)
+			return 0;
+	}
 
-	auto Fut = ThreadPool->submit_task([this, Messages = std::move(Messages)] ()
+	const RequestId Id = Req->Id;
 	{
-		Result Res {};
-		SendRequest(GenerateJson(Messages), Res);
+		std::lock_guard<std::mutex> Lock(QueueMutex);
+		Submitted.push_back(std::move(Req));
+	}
+	curl_multi_wakeup(Multi.get());
+	return Id;
+}
+
+void OpenAIAssistant::CancelRequest(RequestId Id)
+{
+	if (!Id || !LoopThread.joinable())
+		return;
 
-		if (ResCallback)
-			ResCallback(Res);
-	});
+	{
+		std::lock_guard<std::mutex> Lock(QueueMutex);
+		CancelRanges.emplace_back(Id, Id);
+	}
+	curl_multi_wakeup(Multi.get());
 }
 
 void OpenAIAssistant::CancelCurrentRequest()
 {
-	CancelRequestFlag = 1;
+	CancelRequest(NextId.load() - 1);
 }
 
 void OpenAIAssistant::CancelAllRequests()
 {
-	CancelRequestFlag = 1;
-	if (ThreadPool)
-		ThreadPool->purge();
+	if (!LoopThread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> Lock(QueueMutex);
+		CancelRanges.emplace_back(1, NextId.load() - 1);
+	}
+	curl_multi_wakeup(Multi.get());
+}
+
+IAssistant::Stats OpenAIAssistant::GetStats() const
+{
+	std::lock_guard<std::mutex> Lock(StatsMutex);
+	return CurStats;
+}
+
+void OpenAIAssistant::RunLoop()
+{
+	while (!StopFlag.load())
+	{
+		AcceptRequests();
+		PumpReplays();
+
+		int NumRunning = 0;
+		CURLMcode Code = curl_multi_perform(Multi.get(), &NumRunning);
+		if (Code != CURLM_OK)
+		{
+			loge("curl_multi_perform Error={}", (int)Code);
+		}
+
+		int NumMessages = 0;
+		while (CURLMsg* Msg = curl_multi_info_read(Multi.get(), &NumMessages))
+		{
+			if (Msg->msg == CURLMSG_DONE)
+				FinishRequest(Msg->easy_handle, Msg->data.result);
+		}
+
+		int Timeout = 1000;
+		if (!Replays.empty()) // next cached delta due
+			Timeout = (ReplayRate > 0 ? std::clamp((int)(1000 / ReplayRate), 1, 1000) : 0);
+
+		curl_multi_poll(Multi.get(), nullptr, 0, Timeout, nullptr); // curl_multi_wakeup breaks it
+	}
+
+	// SHUTTING DOWN, NOBODY LISTENS ANYMORE
+	for (auto& [Id, Req] : Active)
+	{
+		curl_multi_remove_handle(Multi.get(), Req->Curl.get());
+	}
+	Active.clear();
+	Replays.clear();
+	InFlight.clear();
+}
+
+void OpenAIAssistant::AcceptRequests()
+{
+	std::vector<std::unique_ptr<Request>> NewRequests;
+	std::vector<std::pair<RequestId, RequestId>> NewCancels;
+	{
+		std::lock_guard<std::mutex> Lock(QueueMutex);
+		NewRequests.swap(Submitted);
+		NewCancels.swap(CancelRanges);
+	}
+
+	for (auto& Req : NewRequests)
+	{
+		if (!Req->Prewarm)
+		{
+			PrepareRequest(Req.get());
+			const RequestId Adopt = Req->Options.Adopt;
+			const bool Handled = (ReplayRequest(Req) || JoinRequest(Req));
+			if (Adopt) // replaced request is cancelled either way, when joined the transfer goes on for its new follower
+				CancelActive(Adopt, Adopt);
+			if (Handled)
+				continue;
+			if (CoalesceRequests)
+				InFlight[Req->CacheKey] = Req.get();
+		}
+		Waiting.push_back(std::move(Req));
+	}
+
+	for (const auto& [FirstId, LastId] : NewCancels)
+	{
+		CancelActive(FirstId, LastId);
+	}
+
+	while (!Waiting.empty() && (int)Active.size() < std::max(MaxRequests, 1))
+	{
+		auto Req = std::move(Waiting.front());
+		Waiting.pop_front();
+		StartRequest(std::move(Req));
+	}
+}
+
+void OpenAIAssistant::StartRequest(std::unique_ptr<Request> Req)
+{
+	if (!IdleHandles.empty())
+	{
+		Req->Curl = std::move(IdleHandles.back());
+		IdleHandles.pop_back();
+	}
+	else
+	{
+		Req->Curl.reset(curl_easy_init());
+		if (!Req->Curl)
+		{
+			loge("curl_easy_init");
+			Req->Res.Failed = true;
+			ForgetRequest(Req.get());
+			Deliver(Req.get());
+			RecycleRequest(Req.get());
+			return;
+		}
+		SetupConnection(Req->Curl.get());
+	}
+
+	CURL* Handle = Req->Curl.get();
+	const std::string& Url = (Req->Prewarm ? BackendUrl : Req->Url);
+	const float Timeout = (Req->Options.Timeout > 0 ? Req->Options.Timeout : RequestTimeout);
+
+	long HttpVersion = CURL_HTTP_VERSION_1_1;
+	if (UseHttp2) // h2c prior knowledge for http://, ALPN for https://
+		HttpVersion = (Url.rfind("https://", 0) == 0 ? CURL_HTTP_VERSION_2TLS : CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE);
+
+	curl_easy_setopt(Handle, CURLOPT_URL, Url.c_str());
+	curl_easy_setopt(Handle, CURLOPT_HTTP_VERSION, HttpVersion);
+	curl_easy_setopt(Handle, CURLOPT_HTTPHEADER, Req->Headers ? Req->Headers.get() : Headers.get());
+	curl_easy_setopt(Handle, CURLOPT_TIMEOUT_MS, (long)(Timeout * 1000));
+	curl_easy_setopt(Handle, CURLOPT_WRITEDATA, Req.get());
+	curl_easy_setopt(Handle, CURLOPT_PRIVATE, Req.get());
+	curl_easy_setopt(Handle, CURLOPT_NOBODY, Req->Prewarm ? 1L : 0L);
+
+	if (!Req->Prewarm)
+	{
+		UpdatePrefix(Req.get());
+
+		Req->FullMessage.reserve(4096);
+		curl_easy_setopt(Handle, CURLOPT_POSTFIELDSIZE, (long)Req->Body->GetSize());
+		curl_easy_setopt(Handle, CURLOPT_POSTFIELDS, Req->Body->GetString());
+	}
+
+	CURLMcode Code = curl_multi_add_handle(Multi.get(), Handle);
+	if (Code != CURLM_OK)
+	{
+		loge("curl_multi_add_handle Error={}", (int)Code);
+		Req->Res.Failed = true;
+		ForgetRequest(Req.get());
+		Deliver(Req.get());
+		RecycleRequest(Req.get());
+		return;
+	}
+
+	const RequestId Id = Req->Id;
+	Active[Id] = std::move(Req);
+}
+
+void OpenAIAssistant::FinishRequest(CURL* Handle, CURLcode Error)
+{
+	Request* Req = nullptr;
+	curl_easy_getinfo(Handle, CURLINFO_PRIVATE, (char**)&Req);
+	if (!Req)
+		return;
+
+	curl_multi_remove_handle(Multi.get(), Handle);
+
+	if (Req->Prewarm)
+	{
+		if (Error == CURLE_OK)
+		{
+			double ConnectTime = 0, AppConnectTime = 0;
+			curl_easy_getinfo(Handle, CURLINFO_CONNECT_TIME, &ConnectTime);
+			curl_easy_getinfo(Handle, CURLINFO_APPCONNECT_TIME, &AppConnectTime);
+			logi("Assistant connected: tcp {:.1f} ms, tls {:.1f} ms", ConnectTime * 1e3, AppConnectTime * 1e3);
+		}
+		else
+		{
+			loge("Assistant prewarm Error={}", (int)Error);
+		}
+	}
+	else
+	{
+		if (Req->Mode == 1)
+		{
+			Req->Framer.Finish([this, Req](std::string_view Event, std::string& Data) { HandleEvent(Req, Event, Data); });
+		}
+		else if (Req->Mode == 2 && Error == CURLE_OK)
+		{
+			HandleJson(Req, Req->Response.data());
+		}
+
+		if (Error != CURLE_OK)
+		{
+			loge("Assistant request {} Error={}", Req->Id, (int)Error);
+			Req->Res.Cancelled = (Error == CURLE_OPERATION_TIMEDOUT);
+			Req->Res.Failed = !Req->Res.Cancelled;
+		}
+		else
+		{
+			long NumConnects = 0;
+			curl_easy_getinfo(Handle, CURLINFO_NUM_CONNECTS, &NumConnects);
+			if (NumConnects > 0)
+				logi("Assistant request {} opened {} new connection(s)", Req->Id, NumConnects);
+		}
+
+		if (!Req->Done) // no [DONE], still deliver what we got
+		{
+			Req->Res.Content = std::move(Req->FullMessage);
+			Req->Res.Partial = false;
+		}
+
+		if (Error == CURLE_OK)
+		{
+			CommitPrefix(Req);
+			StoreResponse(Req, Handle); // before Deliver, callback may take the content
+		}
+
+		ForgetRequest(Req);
+		Deliver(Req);
+	}
+
+	auto Iter = Active.find(Req->Id);
+	if (Iter != Active.end())
+	{
+		RecycleRequest(Req);
+		Active.erase(Iter);
+	}
 }
 
-std::string OpenAIAssistant::GenerateJson(const std::vector<Message>& Messages)
+void OpenAIAssistant::CancelActive(RequestId FirstId, RequestId LastId)
+{
+	for (auto Iter = Active.begin(); Iter != Active.end(); )
+	{
+		Request* Req = Iter->second.get();
+		if (Req->Prewarm || !CancelSubscribers(Req, FirstId, LastId))
+		{
+			++Iter;
+			continue;
+		}
+		curl_multi_remove_handle(Multi.get(), Req->Curl.get()); // aborts transfer, connection is closed
+		ForgetRequest(Req);
+		RecycleRequest(Req);
+		Iter = Active.erase(Iter);
+	}
+
+	for (auto Iter = Waiting.begin(); Iter != Waiting.end(); )
+	{
+		Request* Req = Iter->get();
+		if (Req->Prewarm || !CancelSubscribers(Req, FirstId, LastId))
+		{
+			++Iter;
+			continue;
+		}
+		ForgetRequest(Req);
+		RecycleRequest(Req);
+		Iter = Waiting.erase(Iter);
+	}
+
+	for (auto Iter = Replays.begin(); Iter != Replays.end(); )
+	{
+		Request* Req = Iter->get();
+		if (Req->Id < FirstId || Req->Id > LastId)
+		{
+			++Iter;
+			continue;
+		}
+		const auto& Entry = *Req->Replay;
+		Req->Res.Content.assign(Entry.Content, 0, Req->ReplayDelta ? Entry.Deltas[Req->ReplayDelta - 1] : 0);
+		Req->Res.Partial = false;
+		Req->Res.Cancelled = true;
+		DeliverOwn(Req);
+		Iter = Replays.erase(Iter);
+	}
+}
+
+// cancel leader and/or followers in range, true when nobody listens to the transfer anymore
+bool OpenAIAssistant::CancelSubscribers(Request* Req, RequestId FirstId, RequestId LastId)
+{
+	auto InRange = [=](RequestId Id) { return Id >= FirstId && Id <= LastId; };
+
+	for (auto Iter = Req->Followers.begin(); Iter != Req->Followers.end(); )
+	{
+		Request* Follower = Iter->get();
+		if (!InRange(Follower->Id))
+		{
+			++Iter;
+			continue;
+		}
+		Follower->Res.Content = Req->FullMessage;
+		Follower->Res.Partial = false;
+		Follower->Res.Cancelled = true;
+		DeliverOwn(Follower);
+		Iter = Req->Followers.erase(Iter);
+	}
+
+	if (!Req->Detached && InRange(Req->Id))
+	{
+		if (Req->Followers.empty())
+			Req->Res.Content = std::move(Req->FullMessage);
+		else
+			Req->Res.Content = Req->FullMessage;
+		Req->Res.Partial = false;
+		Req->Res.Cancelled = true;
+		DeliverOwn(Req);
+		Req->Res.Cancelled = false; // followers still get the real outcome
+		Req->Detached = true;
+	}
+
+	return Req->Detached && Req->Followers.empty();
+}
+
+void OpenAIAssistant::RecycleRequest(Request* Req)
+{
+	if (Req->Curl)
+		IdleHandles.push_back(std::move(Req->Curl));
+	if (Req->Body)
+		BodyPool.push_back(std::move(Req->Body));
+}
+
+// followers get a copy first, callbacks are allowed to steal the content
+void OpenAIAssistant::Deliver(Request* Req)
+{
+	for (auto& Follower : Req->Followers)
+	{
+		Result& Res = Follower->Res;
+		Res.Content = Req->Res.Content;
+		Res.Partial = Req->Res.Partial;
+		Res.Cancelled = Req->Res.Cancelled;
+		Res.Failed = Req->Res.Failed;
+		Res.PromptTokens = Req->Res.PromptTokens;
+		Res.CachedTokens = Req->Res.CachedTokens;
+		DeliverOwn(Follower.get());
+	}
+
+	if (!Req->Detached)
+		DeliverOwn(Req);
+}
+
+void OpenAIAssistant::DeliverOwn(Request* Req)
+{
+	auto& Callback = (Req->Options.Callback ? Req->Options.Callback : ResCallback);
+	if (Callback)
+		Callback(Req->Res);
+}
+
+void OpenAIAssistant::PrepareRequest(Request* Req)
+{
+	Req->Url = (Req->Options.Url.empty() ? BackendUrl : Req->Options.Url);
+	std::shared_ptr<const ModelParams> CurParams;
+	{
+		std::lock_guard<std::mutex> Lock(ParamsMutex);
+		CurParams = PublishedParams;
+	}
+
+	Req->SlotId = (Req->Options.SlotId >= 0 ? Req->Options.SlotId : CurParams->SlotId);
+	Req->SessionKey = fmt::format("{}#{}", Req->Url, Req->SlotId);
+
+	if (!BodyPool.empty())
+	{
+		Req->Body = std::move(BodyPool.back());
+		BodyPool.pop_back();
+	}
+	else
+	{
+		Req->Body = std::make_unique<rapidjson::StringBuffer>();
+	}
+	GenerateJson(Req->Messages, *CurParams, Req->SlotId, (Req->Options.MaxTokens >= 0 ? Req->Options.MaxTokens : CurParams->MaxTokens), *Req->Body);
+
+	// body has messages and every model param, so it is the cache key as is
+	const uint64_t UrlHash = XXH3_64bits(Req->Url.data(), Req->Url.size());
+	Req->CacheKey = XXH3_64bits_withSeed(Req->Body->GetString(), Req->Body->GetSize(), UrlHash);
+}
+
+bool OpenAIAssistant::ReplayRequest(std::unique_ptr<Request>& Req)
+{
+	if (!CacheResponses)
+		return false;
+
+	Req->Replay = Responses.Find(Req->CacheKey);
+	if (!Req->Replay)
+		return false;
+
+	logi("Assistant request {} answered from cache", Req->Id);
+	{
+		std::lock_guard<std::mutex> Lock(StatsMutex);
+		CurStats.CacheHits++;
+	}
+
+	RecycleRequest(Req.get());
+	Req->ReplayStart = std::chrono::steady_clock::now();
+	Replays.push_back(std::move(Req));
+	return true;
+}
+
+bool OpenAIAssistant::JoinRequest(std::unique_ptr<Request>& Req)
+{
+	Request* Leader = FindAdopted(Req.get());
+	if (!Leader && CoalesceRequests)
+	{
+		auto Iter = InFlight.find(Req->CacheKey);
+		if (Iter != InFlight.end())
+			Leader = Iter->second;
+	}
+	if (!Leader)
+		return false;
+
+	logi("Assistant request {} joined request {}", Req->Id, Leader->Id);
+	{
+		std::lock_guard<std::mutex> Lock(StatsMutex);
+		CurStats.Coalesced++;
+	}
+
+	RecycleRequest(Req.get());
+	if (!Leader->FullMessage.empty()) // catch up with what already streamed
+	{
+		Req->Res.Content = Leader->FullMessage;
+		Req->Res.Partial = true;
+		DeliverOwn(Req.get());
+	}
+	Leader->Followers.push_back(std::move(Req));
+	return true;
+}
+
+// request named by Options.Adopt, only while it still runs (or waits) with the very same body
+OpenAIAssistant::Request* OpenAIAssistant::FindAdopted(const Request* Req)
+{
+	const RequestId Id = Req->Options.Adopt;
+	if (!Id)
+		return nullptr;
+
+	Request* Found = nullptr;
+	auto Iter = Active.find(Id);
+	if (Iter != Active.end())
+	{
+		Found = Iter->second.get();
+	}
+	else
+	{
+		for (auto& Waiter : Waiting)
+		{
+			if (Waiter->Id == Id)
+			{
+				Found = Waiter.get();
+				break;
+			}
+		}
+	}
+
+	if (!Found || Found->Prewarm || Found->Detached || Found->CacheKey != Req->CacheKey)
+		return nullptr;
+	return Found;
+}
+
+void OpenAIAssistant::ForgetRequest(Request* Req)
+{
+	auto Iter = InFlight.find(Req->CacheKey);
+	if (Iter != InFlight.end() && Iter->second == Req)
+		InFlight.erase(Iter);
+}
+
+void OpenAIAssistant::StoreResponse(Request* Req, CURL* Handle)
+{
+	if (!CacheResponses || Req->Res.Failed || Req->Res.Cancelled || Req->Res.Content.empty())
+		return;
+
+	if (Req->Mode != 2 && !Req->Done) // stream closed without [DONE], answer may be cut off
+		return;
+
+	long Status = 0;
+	curl_easy_getinfo(Handle, CURLINFO_RESPONSE_CODE, &Status);
+	if (Status != 200)
+		return;
+
+	ResponseCache::Entry Entry;
+	Entry.Content = Req->Res.Content;
+	if (!Req->DeltaEnds.empty() && Req->DeltaEnds.back() == Entry.Content.size())
+		Entry.Deltas = std::move(Req->DeltaEnds);
+	else
+		Entry.Deltas.push_back((uint32_t)Entry.Content.size()); // plain json answer, one piece
+
+	Responses.Insert(Req->CacheKey, std::move(Entry));
+}
+
+// cached answers go out like a stream, due deltas of one tick are merged
+void OpenAIAssistant::PumpReplays()
+{
+	const auto Now = std::chrono::steady_clock::now();
+
+	for (auto Iter = Replays.begin(); Iter != Replays.end(); )
+	{
+		Request* Req = Iter->get();
+		const auto& Entry = *Req->Replay;
+		const size_t NumDeltas = Entry.Deltas.size();
+
+		size_t NumDue = NumDeltas;
+		if (ReplayRate > 0)
+		{
+			const double Elapsed = std::chrono::duration<double>(Now - Req->ReplayStart).count();
+			NumDue = std::min(NumDeltas, (size_t)(Elapsed * ReplayRate) + 1);
+		}
+
+		if (NumDue > Req->ReplayDelta)
+		{
+			const size_t Begin = (Req->ReplayDelta ? Entry.Deltas[Req->ReplayDelta - 1] : 0);
+			const size_t End = Entry.Deltas[NumDue - 1];
+			Req->Res.Content.assign(Entry.Content, Begin, End - Begin);
+			Req->Res.Partial = true;
+			DeliverOwn(Req);
+			Req->ReplayDelta = NumDue;
+		}
+
+		if (Req->ReplayDelta < NumDeltas)
+		{
+			++Iter;
+			continue;
+		}
+
+		Req->Res.Content = Entry.Content;
+		Req->Res.Partial = false;
+		DeliverOwn(Req);
+		Iter = Replays.erase(Iter);
+	}
+}
+
+// SAX straight into reused buffer, no DOM, no string copies
+void OpenAIAssistant::GenerateJson(const std::vector<Message>& Messages, const ModelParams& Params, int SlotId, int NumTokens, rapidjson::StringBuffer& Buffer)
 {
 	using namespace rapidjson;
-	Document doc;
-	doc.SetObject();
-	Document::AllocatorType& allocator = doc.GetAllocator();
 
-	//doc.AddMember("model", Value().SetString("gpt-3.5-turbo", allocator), allocator);
-	//doc.AddMember("temperature", 0, allocator);
-	//doc.AddMember("max_tokens", 1000, allocator);
-	doc.AddMember("stream", true, allocator);
+	size_t Estimate = 256;
+	for (const auto& msg : Messages)
+	{
+		Estimate += msg.Role.size() + msg.Content.size() + msg.Content.size() / 8 + 32; // some escapes
+	}
+
+	Buffer.Clear();
+	Buffer.Reserve(Estimate);
+	JsonWriter.Reset(Buffer);
+	JsonWriter.SetMaxDecimalPlaces(4); // float config values, 0.2f not 0.20000000298
+
+	auto& w = JsonWriter;
+	w.StartObject();
+
+	if (!Params.Model.empty())
+	{
+		w.Key("model"); w.String(Params.Model.c_str(), (SizeType)Params.Model.size());
+	}
+	if (Params.Temperature >= 0)
+	{
+		w.Key("temperature"); w.Double(Params.Temperature);
+	}
+	if (NumTokens > 0)
+	{
+		w.Key("max_tokens"); w.Int(NumTokens);
+	}
+	if (Params.Seed >= 0)
+	{
+		w.Key("seed"); w.Int(Params.Seed);
+	}
+	if (!Params.StopList.empty())
+	{
+		w.Key("stop");
+		w.StartArray();
+		for (const auto& str : Params.StopList)
+			w.String(str.c_str(), (SizeType)str.size());
+		w.EndArray();
+	}
+
+	w.Key("stream"); w.Bool(true);
+	if (Params.CachePrompt)
+	{
+		w.Key("cache_prompt"); w.Bool(true);
+		if (SlotId >= 0)
+		{
+			w.Key("id_slot"); w.Int(SlotId);
+		}
+	}
+	if (Params.RequestUsage) // extra last chunk with usage
+	{
+		w.Key("stream_options");
+		w.StartObject();
+		w.Key("include_usage"); w.Bool(true);
+		w.EndObject();
+	}
 
-	Value jmessages(kArrayType);
+	w.Key("messages");
+	w.StartArray();
 	for (const auto& msg : Messages)
 	{
-		Value jmessage(kObjectType);
-		jmessage.AddMember("role", Value().SetString(msg.Role.c_str(), allocator), allocator);
-		jmessage.AddMember("content", Value().SetString(msg.Content.c_str(), allocator), allocator);
-		jmessages.PushBack(jmessage, allocator);
+		w.StartObject();
+		w.Key("role"); w.String(msg.Role.c_str(), (SizeType)msg.Role.size());
+		w.Key("content"); w.String(msg.Content.c_str(), (SizeType)msg.Content.size());
+		w.EndObject();
 	}
-	doc.AddMember("messages", jmessages, allocator);
+	w.EndArray();
 
-	StringBuffer buffer;
-	Writer<StringBuffer> writer(buffer);
-	doc.Accept(writer);
+	w.EndObject();
+}
 
-	return buffer.GetString();
+uint64_t OpenAIAssistant::HashMessage(std::string_view Role, std::string_view Content)
+{
+	const uint64_t RoleHash = XXH3_64bits(Role.data(), Role.size());
+	return XXH3_64bits_withSeed(Content.data(), Content.size(), RoleHash);
 }
 
-void OpenAIAssistant::SendRequest(const std::string& RequestData, Result& Res)
+// prompt is always the full conversation (chat api is stateless), server can only skip the part it still holds in KV
+void OpenAIAssistant::UpdatePrefix(Request* Req)
 {
-	CurlContext context {};
-	context.Solver = this;
-	context.Res = &Res;
-	context.Message.reserve(1024);
+	Req->MessageHashes.clear();
+	Req->MessageHashes.reserve(Req->Messages.size() + 1);
+	for (const auto& Msg : Req->Messages)
+	{
+		Req->MessageHashes.push_back(HashMessage(Msg.Role, Msg.Content));
+	}
 
-	curl_easy_reset(Curl.get());
+	auto& Held = Sessions[Req->SessionKey].MessageHashes;
+	const size_t MaxCommon = std::min(Held.size(), Req->MessageHashes.size());
+	size_t NumCommon = 0;
+	while (NumCommon < MaxCommon && Held[NumCommon] == Req->MessageHashes[NumCommon])
+		++NumCommon;
 
-	curl_easy_setopt(Curl.get(), CURLOPT_XFERINFODATA, &context);
-	curl_easy_setopt(Curl.get(), CURLOPT_XFERINFOFUNCTION, CurlProgressCallback);
-	curl_easy_setopt(Curl.get(), CURLOPT_NOPROGRESS, 0L);
+	const bool Hit = (NumCommon > 0 && NumCommon == Held.size());
 
-	curl_easy_setopt(Curl.get(), CURLOPT_WRITEDATA, &context);
-	curl_easy_setopt(Curl.get(), CURLOPT_WRITEFUNCTION, CurlWriteCallback);
+	std::lock_guard<std::mutex> Lock(StatsMutex);
+	CurStats.Requests++;
+	CurStats.PrefixHits += (Hit ? 1 : 0);
+	CurStats.MessagesSent += Req->MessageHashes.size();
+	CurStats.MessagesReused += NumCommon;
+}
 
-	curl_easy_setopt(Curl.get(), CURLOPT_URL, BackendUrl.c_str());
-	curl_easy_setopt(Curl.get(), CURLOPT_HTTPHEADER, Headers.get());
-	curl_easy_setopt(Curl.get(), CURLOPT_POSTFIELDS, RequestData.c_str());
-	curl_easy_setopt(Curl.get(), CURLOPT_POST, 1L);
+void OpenAIAssistant::CommitPrefix(Request* Req)
+{
+	// server now holds this prompt followed by its answer
+	auto& Held = Sessions[Req->SessionKey].MessageHashes;
+	Held = Req->MessageHashes;
+	if (!Req->Res.Content.empty())
+		Held.push_back(HashMessage("assistant", Req->Res.Content));
 
-	CURLcode Error = curl_easy_perform(Curl.get()); // blocking
-	if (Error != CURLE_OK)
+	if (Req->Res.PromptTokens >= 0)
 	{
-		loge("curl_easy_perform Error={}", (int)Error);
+		logi("Assistant request {} prompt {} tokens, {} cached", Req->Id, Req->Res.PromptTokens, std::max(Req->Res.CachedTokens, 0));
+
+		std::lock_guard<std::mutex> Lock(StatsMutex);
+		CurStats.PromptTokens += Req->Res.PromptTokens;
+		CurStats.CachedTokens += std::max(Req->Res.CachedTokens, 0);
 	}
 }
 
-int OpenAIAssistant::ProgressCallback(CurlContext* clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
+void OpenAIAssistant::SetupConnection(CURL* Handle) // once per easy handle, request specific options are set in StartRequest
 {
-	return CancelRequestFlag.load() ? 1 : 0; // non-zero return cancels the transfer
+	curl_easy_setopt(Handle, CURLOPT_WRITEFUNCTION, CurlWriteCallback);
+	curl_easy_setopt(Handle, CURLOPT_NOSIGNAL, 1L);
+
+	curl_easy_setopt(Handle, CURLOPT_CONNECTTIMEOUT, (long)ConnectTimeout);
+	curl_easy_setopt(Handle, CURLOPT_TCP_NODELAY, 1L); // prompt is one small write, don't wait for ack
+	curl_easy_setopt(Handle, CURLOPT_TCP_KEEPALIVE, KeepAliveIdle > 0 ? 1L : 0L);
+	if (KeepAliveIdle > 0)
+	{
+		curl_easy_setopt(Handle, CURLOPT_TCP_KEEPIDLE, (long)KeepAliveIdle);
+		curl_easy_setopt(Handle, CURLOPT_TCP_KEEPINTVL, (long)std::max(KeepAliveIdle / 3, 1));
+	}
+	curl_easy_setopt(Handle, CURLOPT_MAXAGE_CONN, (long)MaxConnectionAge);
+	curl_easy_setopt(Handle, CURLOPT_DNS_CACHE_TIMEOUT, (long)MaxConnectionAge);
+
+	curl_easy_setopt(Handle, CURLOPT_PIPEWAIT, UseHttp2 ? 1L : 0L); // prefer multiplexing over a new connection
 }
 
-size_t OpenAIAssistant::WriteCallback(char *ptr, size_t size, size_t nmemb, CurlContext* context)
+size_t OpenAIAssistant::WriteCallback(char *ptr, size_t size, size_t nmemb, Request* Req)
 {
-	assert(context);
-	assert(context->Res);
-
-	Result& Res = *context->Res;
+	assert(Req);
 
 	const size_t TotalSize = size * nmemb;
-	std::string str(ptr, TotalSize / sizeof(char));
-	
-	if (str.find("data: [DONE]") != std::string::npos) // end of event-stream
+	size_t Offset = 0;
+
+	if (!Req->Mode) // sniff first non-blank byte, json body means no stream (error or stream=false)
+	{
+		while (Offset < TotalSize && isspace((unsigned char)ptr[Offset]))
+			++Offset;
+		if (Offset == TotalSize)
+			return TotalSize;
+		Req->Mode = (ptr[Offset] == '{' || ptr[Offset] == '[') ? 2 : 1;
+	}
+
+	if (Req->Mode == 1)
+	{
+		Req->Framer.Feed(ptr + Offset, TotalSize - Offset, [this, Req](std::string_view Event, std::string& Data)
+		{
+			HandleEvent(Req, Event, Data);
+		});
+	}
+	else
 	{
-		Res.Content = std::move(context->Message);
-		Res.Partial = false;
-		return TotalSize;
+		Req->Response.append(ptr + Offset, TotalSize - Offset);
 	}
 
-	// clear "data:" prefix because rapidjson dont like it
-	const size_t pos = str.find_first_of('{');
-	if (pos != std::string::npos)
+	return TotalSize;
+}
+
+void OpenAIAssistant::HandleEvent(Request* Req, std::string_view Event, std::string& Data)
+{
+	if (Data == "[DONE]") // end of event-stream
+	{
+		Req->Res.Content = std::move(Req->FullMessage);
+		Req->Res.Partial = false;
+		Req->Done = true;
+		return;
+	}
+
+	if (Event == "error")
 	{
-		for (size_t i = 0; i < pos; ++i)
-			str[i] = ' ';
+		loge("Assistant error event: {}", Data);
+		return;
 	}
 
+	HandleJson(Req, Data.data());
+}
+
+void OpenAIAssistant::HandleJson(Request* Req, char* Json)
+{
 	using namespace rapidjson;
-	Document doc;
-	ParseResult pr = doc.Parse(str.c_str());
+
+	Result& Res = Req->Res;
+
+	JsonValueAllocator.Clear();
+	JsonStackAllocator.Clear();
+	PoolDocument doc(&JsonValueAllocator, JsonStackCapacity, &JsonStackAllocator);
+
+	ParseResult pr = doc.ParseInsitu(Json); // strings point into Json, no copies
 	if (!pr)
 	{
-		loge("Document::Parse Error={} Offset={}", (int)pr.Code(), pr.Offset());
-		return TotalSize;
+		loge("Document::ParseInsitu Error={} Offset={}", (int)pr.Code(), pr.Offset());
+		return;
+	}
+
+	if (!doc.IsObject())
+		return;
+
+	if (doc.HasMember("error"))
+	{
+		const auto& error = doc["error"];
+		if (error.IsObject() && error.HasMember("message") && error["message"].IsString())
+			loge("Assistant error: {}", error["message"].GetString());
+		else if (error.IsString())
+			loge("Assistant error: {}", error.GetString());
+		return;
+	}
+
+	// llama.cpp puts timings into the last chunk, OpenAI style servers send usage
+	if (doc.HasMember("timings") && doc["timings"].IsObject())
+	{
+		const auto& timings = doc["timings"];
+		if (timings.HasMember("prompt_n") && timings["prompt_n"].IsInt() && timings.HasMember("cache_n") && timings["cache_n"].IsInt())
+		{
+			Res.CachedTokens = timings["cache_n"].GetInt();
+			Res.PromptTokens = timings["prompt_n"].GetInt() + Res.CachedTokens; // prompt_n counts evaluated tokens only
+		}
+	}
+	else if (doc.HasMember("usage") && doc["usage"].IsObject())
+	{
+		const auto& usage = doc["usage"];
+		if (usage.HasMember("prompt_tokens") && usage["prompt_tokens"].IsInt())
+		{
+			Res.PromptTokens = usage["prompt_tokens"].GetInt();
+			if (usage.HasMember("prompt_tokens_details") && usage["prompt_tokens_details"].IsObject())
+			{
+				const auto& details = usage["prompt_tokens_details"];
+				if (details.HasMember("cached_tokens") && details["cached_tokens"].IsInt())
+					Res.CachedTokens = details["cached_tokens"].GetInt();
+			}
+		}
 	}
 
 	// HERE WE GO BRAINFUCK
 	if (doc.HasMember("choices") && doc["choices"].IsArray())
 	{
-		const Value& choices = doc["choices"];
+		const auto& choices = doc["choices"];
 		//for (SizeType i = 0; i < choices.Size(); ++i)
 		if (choices.Size() > 0)
 		{
-			const Value& choice = choices[0];
+			const auto& choice = choices[0];
 			if (choice.HasMember("delta")) // event-stream
 			{
-				const Value& delta = choice["delta"];
+				const auto& delta = choice["delta"];
 				if (delta.HasMember("content") && delta["content"].IsString())
 				{
-					context->Message.append(delta["content"].GetString()); // accumulate full message
-					Res.Content.assign(delta["content"].GetString()); // pass delta to callback
+					const auto& content = delta["content"];
+					Req->FullMessage.append(content.GetString(), content.GetStringLength()); // accumulate full message
+					if (CacheResponses)
+						Req->DeltaEnds.push_back((uint32_t)Req->FullMessage.size());
+					Res.Content.assign(content.GetString(), content.GetStringLength()); // pass delta to callback
 					Res.Partial = true;
-					ResCallback(Res);
+					Deliver(Req);
 				}
 			}
 			#if 1
 			else if (choice.HasMember("message") && choice["message"].IsObject())
 			{
-				const Value& message = choice["message"];
+				const auto& message = choice["message"];
 				if (message.HasMember("role") && message["role"].IsString()
 					&& message.HasMember("content") && message["content"].IsString())
 				{
 					// message["role"].GetString()
-					context->Message.assign(message["content"].GetString());
+					Req->FullMessage.assign(message["content"].GetString(), message["content"].GetStringLength());
 				}
 			}
 			#endif
 		}
 	}
-
-	return TotalSize;
 }
 
 IAssistant* IAssistant::CreateInstance()
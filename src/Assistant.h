@@ -1,6 +1,6 @@
 #pragma once
 
-#include "AUGCore.h"
+#include "IniFile.h"
 
 class IAssistant
 {
@@ -8,6 +8,8 @@ public:
 
 	static IAssistant* CreateInstance();
 
+	using RequestId = uint64_t;
+
 	struct Message
 	{
 		std::string Role;
@@ -16,18 +18,52 @@ public:
 
 	struct Result
 	{
+		RequestId Id = 0;
 		std::string Content;
 		bool Partial = false;
+		bool Cancelled = false; // final result of cancelled or timed out request, Content is what arrived so far
+		bool Failed = false; // transport error
+		int PromptTokens = -1; // final result, when server reports usage/timings
+		int CachedTokens = -1; // prompt tokens served from server KV cache
 
 		AUG_MOVABLE_NONCOPYABLE(Result);
 	};
 
 	using ResultCallback = std::function<void(Result&)>;
 
+	struct RequestOptions
+	{
+		std::string Url; // empty: backend from Init
+		std::string Token; // only used with Url
+		ResultCallback Callback; // empty: callback from Init
+		float Timeout = 0; // seconds for whole request, 0: RequestTimeout from config
+		int SlotId = -1; // llama.cpp server slot, -1: SlotId from config
+		int MaxTokens = -1; // -1: MaxTokens from config, 1 just evaluates the prompt (warms server KV cache)
+		RequestId Adopt = 0; // request this one replaces: joined when identical and still running (even with CoalesceRequests=0), cancelled otherwise
+	};
+
+	struct Stats
+	{
+		uint64_t Requests = 0;
+		uint64_t PrefixHits = 0; // request extended the conversation the server already holds
+		uint64_t MessagesSent = 0;
+		uint64_t MessagesReused = 0; // part of the held prefix
+		uint64_t PromptTokens = 0; // as reported by server
+		uint64_t CachedTokens = 0;
+		uint64_t CacheHits = 0; // answered from local response cache, backend never saw it
+		uint64_t Coalesced = 0; // joined identical request already in flight
+	};
+
 	virtual ~IAssistant() {}
 	virtual bool Init(std::string Url, std::string Token, ResultCallback Callback) = 0;
 	virtual void Release() = 0;
-	virtual void Process(std::vector<Message> Messages) = 0;
-	virtual void CancelCurrentRequest() = 0;
+	virtual void Serialize(IniFile& Config, bool Save) = 0;
+
+	// requests run concurrently, callbacks come from the assistant thread, returns 0 when not accepted
+	virtual RequestId Process(std::vector<Message> Messages, RequestOptions Options) = 0;
+	RequestId Process(std::vector<Message> Messages) { return Process(std::move(Messages), RequestOptions()); }
+	virtual void CancelRequest(RequestId Id) = 0;
+	virtual void CancelCurrentRequest() = 0; // most recent one
 	virtual void CancelAllRequests() = 0;
+	virtual Stats GetStats() const = 0;
 };
@@ -5,36 +5,134 @@
 #include <opencv2/opencv.hpp>
 #include <opencv2/text/ocr.hpp>
 #include <tesseract/baseapi.h>
+#include <tesseract/ocrclass.h>
 #include <leptonica/allheaders.h>
+#include <xxh3.h>
+
+#include <mutex>
+#include <future>
+#include <condition_variable>
 
 class TesseractImageToText : public IImageToText
 {
 public:
 
+	TesseractImageToText(IScreenCapture* Capture) : ScreenCapture(Capture) {}
 	virtual ~TesseractImageToText() override { Release(); }
 	virtual bool Init(ResultCallback Callback) override;
 	virtual void Release() override;
+	virtual void Serialize(IniFile& Config, bool Save) override;
 	virtual void Process(IntRect Region) override;
+	virtual void SetContinuous(bool Enable, IntRect Region) override;
+	virtual bool IsContinuous() const override { return ContinuousThread.joinable(); }
 
 private:
 
+	struct Tile
+	{
+		cv::Rect Rect; // in preprocessed image
+		bool NewBlock = false; // first tile of layout block, text gets blank line before it
+	};
+
 	void ProcessTask(IntRect Region, Result& Res);
+	void BackgroundTask(IntRect Region, uint32_t Generation);
+	void ContinuousLoop();
+	void StopContinuous();
+	std::vector<cv::Rect> FindChangedBands(const cv::Mat& Mat);
+	cv::Mat& Preprocess(const cv::Mat& InMat);
+	bool Recognize(const cv::Mat& Mat, cv::Rect Rect, const std::atomic<int>* Preempt, Result& Res);
+	bool RecognizeTiled(const cv::Mat& Mat, cv::Rect Rect, const std::atomic<int>* Preempt, Result& Res);
+	std::vector<Tile> FindTiles(const cv::Mat& Mat);
+	static bool RecognizeImage(tesseract::TessBaseAPI& Api, const cv::Mat& Mat, cv::Rect Rect, const std::atomic<int>* Preempt, Result& Res);
+
+	uint64_t HashImage(const cv::Mat& Mat, cv::Rect Rect);
+	bool FindCached(uint64_t Key, cv::Point Origin, Result& Res);
+	void StoreCached(uint64_t Key, cv::Point Origin, const Result& Res);
+	void TrimCache();
+
+	void CreateRecognizers(int Num);
+	tesseract::TessBaseAPI* AcquireRecognizer();
+	void ReleaseRecognizer(tesseract::TessBaseAPI* Api);
 
 	ResultCallback ResCallback;
 
+	// preprocessing of captured region, tesseract wants ~30 px capital letters, screen text is often half that
+	float Scale = 1.0f; // 2 helps small fonts, costs 4x recognition time
+	bool Binarize = false; // Otsu before tesseract, for low contrast/colored backgrounds
+
+	cv::Mat GrayMat; // reused, thread pool has one thread
+	cv::Mat ScaledMat;
+
+	// tiled mode: layout analysis on TessApi, text blocks recognized in parallel, one tesseract instance per tile thread
+	int NumRecognizers = 0; // 0 auto (half the cores, max 8), 1 off
+	int MinTiledArea = 500 * 500; // smaller regions go single pass, layout + split don't pay off
+	std::vector<std::unique_ptr<tesseract::TessBaseAPI>> Recognizers;
+	std::vector<tesseract::TessBaseAPI*> FreeRecognizers;
+	std::mutex RecognizerMutex;
+	std::unique_ptr<BS::thread_pool<BS::tp::none>> TilePool;
+
+	// dirty rectangle cache: whole preprocessed image and every tile keyed by pixel hash, unchanged content is not recognized again
+	struct CachedTile
+	{
+		std::string Text;
+		std::vector<Detection> Detections; // relative to tile origin, same text moved by scrolling still hits
+		uint32_t LastPass = 0;
+	};
+
+	bool CacheTiles = true;
+	int CacheMaxTiles = 4096; // text lines are a few hundred bytes each
+	std::unordered_map<uint64_t, CachedTile> TileCache;
+	uint32_t Pass = 0;
+	std::unique_ptr<XXH3_state_t, decltype([](XXH3_state_t* Handle) { XXH3_freeState(Handle); })> HashState {};
+
+	// continuous mode: timer thread queues background passes on ThreadPool, only rows that changed in a downscaled diff are recognized
+	float ContinuousRate = 1.0f; // passes per second
+	int ContinuousCpuPercent = 25; // duty cycle of background passes, 0 or 100: no limit
+	int ContinuousMaxInFlight = 2; // tiles recognized at once by background pass, 0: all recognizers
+	int DiffScale = 8; // diff image is 1/DiffScale of preprocessed image
+	int DiffThreshold = 24; // gray levels, below is noise/subpixel AA
+
+	std::thread ContinuousThread;
+	std::mutex ContinuousMutex;
+	std::condition_variable ContinuousCv;
+	bool ContinuousStop = false;
+	IntRect ContinuousRegion {};
+	uint32_t ContinuousGeneration = 0; // SetContinuous, results of older passes are dropped
+	std::chrono::steady_clock::time_point BackgroundIdleUntil {}; // CPU budget, guarded by ContinuousMutex
+	std::atomic<bool> BackgroundBusy = false; // one pass at a time
+	std::atomic<int> PendingRequests = 0; // on-demand Process queued or running, background pass bails out
+
+	// owned by ThreadPool thread
+	cv::Mat DiffMat;
+	cv::Mat PrevDiffMat;
+	cv::Mat DeltaMat;
+	cv::Mat RowMat;
+	std::vector<Detection> BackgroundDetections; // preprocessed image coordinates
+
 	std::unique_ptr<IScreenCapture> ScreenCapture;
 	std::unique_ptr<tesseract::TessBaseAPI> TessApi;
 
 	std::unique_ptr<BS::thread_pool<BS::tp::none>> ThreadPool;
 };
 
+static IntRect ToScreen(const IntRect& Rect, const IntRect& Captured, float ImageScale)
+{
+	return {
+		Captured.Left + (int)(Rect.Left / ImageScale),
+		Captured.Top + (int)(Rect.Top / ImageScale),
+		Captured.Left + (int)ceilf(Rect.Right / ImageScale),
+		Captured.Top + (int)ceilf(Rect.Bottom / ImageScale)
+	};
+}
+
 bool TesseractImageToText::Init(ResultCallback Callback)
 {
 	do
 	{
 		ResCallback = std::move(Callback);
 
-		ScreenCapture.reset(IScreenCapture::CreateInstance()); 
+		if (!ScreenCapture)
+			ScreenCapture.reset(IScreenCapture::CreateInstance());
 		GUARD_BREAK(ScreenCapture->Init(), "Failed to init screen capture");
 
 		setMsgSeverity(L_SEVERITY_ERROR); // STFU leptonica
@@ -54,6 +152,14 @@ bool TesseractImageToText::Init(ResultCallback Callback)
 		//TessApi->SetVariable("save_best_choices", "T");
 	
 		ThreadPool.reset(new BS::thread_pool(1)); // don't change
+		HashState.reset(XXH3_createState());
+
+		const int NumTiled = std::clamp(NumRecognizers > 0 ? NumRecognizers : (int)std::thread::hardware_concurrency() / 2, 1, 8);
+		if (NumTiled > 1)
+		{
+			// every instance loads its own traineddata (~100 ms each), off the GUI thread, first Process queues behind it
+			auto Fut = ThreadPool->submit_task([this, NumTiled]() { CreateRecognizers(NumTiled); });
+		}
 
 		return true;
 	}
@@ -67,28 +173,150 @@ void TesseractImageToText::Release()
 {
 	if (ThreadPool) { logi("TesseractImageToText::Release"); }
 
+	StopContinuous();
 	ResCallback = {};
 	ThreadPool.reset();
-	ScreenCapture.reset();
+	TilePool.reset();
+	FreeRecognizers.clear();
+	Recognizers.clear();
+	TileCache.clear();
+	HashState.reset();
+	if (ScreenCapture) ScreenCapture->Release(); // object stays, may be injected
 	TessApi.reset();
 }
 
+void TesseractImageToText::CreateRecognizers(int Num)
+{
+	for (int i = 0; i < Num; ++i)
+	{
+		auto Api = std::make_unique<tesseract::TessBaseAPI>();
+		if (int TessError = Api->Init(NULL, "eng", tesseract::OEM_LSTM_ONLY))
+		{
+			loge("tess::Init Error={}", TessError);
+			break;
+		}
+		Api->SetPageSegMode(tesseract::PSM_SINGLE_BLOCK); // tile is a run of lines from one block
+		FreeRecognizers.push_back(Api.get());
+		Recognizers.push_back(std::move(Api));
+	}
+
+	if (Recognizers.size() > 1)
+	{
+		TilePool.reset(new BS::thread_pool((int)Recognizers.size())); // one thread per recognizer, AcquireRecognizer never waits
+		logi("Tesseract tiled recognizers={}", Recognizers.size());
+	}
+}
+
+tesseract::TessBaseAPI* TesseractImageToText::AcquireRecognizer()
+{
+	std::lock_guard<std::mutex> Lock(RecognizerMutex);
+	if (FreeRecognizers.empty())
+	{
+		loge("No free recognizer");
+		return nullptr;
+	}
+	tesseract::TessBaseAPI* Api = FreeRecognizers.back();
+	FreeRecognizers.pop_back();
+	return Api;
+}
+
+void TesseractImageToText::ReleaseRecognizer(tesseract::TessBaseAPI* Api)
+{
+	std::lock_guard<std::mutex> Lock(RecognizerMutex);
+	FreeRecognizers.push_back(Api);
+}
+
+void TesseractImageToText::Serialize(IniFile& Config, bool Save)
+{
+	INI_SERIALIZE_PROP("ImageToText", Scale);
+	INI_SERIALIZE_PROP("ImageToText", Binarize);
+	INI_SERIALIZE_PROP("ImageToText", NumRecognizers);
+	INI_SERIALIZE_PROP("ImageToText", MinTiledArea);
+	INI_SERIALIZE_PROP("ImageToText", CacheTiles);
+	INI_SERIALIZE_PROP("ImageToText", CacheMaxTiles);
+	INI_SERIALIZE_PROP("ImageToText", ContinuousRate);
+	INI_SERIALIZE_PROP("ImageToText", ContinuousCpuPercent);
+	INI_SERIALIZE_PROP("ImageToText", ContinuousMaxInFlight);
+	INI_SERIALIZE_PROP("ImageToText", DiffScale);
+	INI_SERIALIZE_PROP("ImageToText", DiffThreshold);
+}
+
 void TesseractImageToText::Process(IntRect Region)
 {
 	if (!ThreadPool)
 		return;
 
+	PendingRequests++; // running background pass gives up the thread
 	auto Fut = ThreadPool->submit_task([this, Region = std::move(Region)] ()
 	{
 		Result Res {};
 
 		ProcessTask(std::move(Region), Res);
+		PendingRequests--;
 
 		if (ResCallback)
 			ResCallback(Res);
 	});
 }
 
+void TesseractImageToText::SetContinuous(bool Enable, IntRect Region)
+{
+	StopContinuous();
+
+	if (!Enable || !ThreadPool)
+		return;
+
+	{
+		std::lock_guard<std::mutex> Lock(ContinuousMutex); // passes still queued from last run read these
+		ContinuousRegion = Region;
+		ContinuousStop = false;
+		ContinuousGeneration++;
+	}
+	ThreadPool->detach_task([this]()
+	{
+		// new region, first pass recognizes everything
+		PrevDiffMat.release();
+		BackgroundDetections.clear();
+	});
+	ContinuousThread = std::thread(&TesseractImageToText::ContinuousLoop, this);
+}
+
+void TesseractImageToText::StopContinuous()
+{
+	if (!ContinuousThread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> Lock(ContinuousMutex);
+		ContinuousStop = true;
+	}
+	ContinuousCv.notify_all();
+	ContinuousThread.join(); // queued pass still runs, drops its result
+}
+
+void TesseractImageToText::ContinuousLoop()
+{
+	using Clock = std::chrono::steady_clock;
+
+	std::unique_lock<std::mutex> Lock(ContinuousMutex);
+	auto NextPass = Clock::now();
+
+	while (!ContinuousCv.wait_until(Lock, NextPass, [this]() { return ContinuousStop; }))
+	{
+		NextPass = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(1.0f / std::max(ContinuousRate, 0.01f)));
+
+		if (BackgroundBusy || PendingRequests > 0 || Clock::now() < BackgroundIdleUntil)
+			continue; // skip tick, never queue up behind the user
+
+		BackgroundBusy = true;
+		ThreadPool->detach_task([this, Region = ContinuousRegion, Generation = ContinuousGeneration]()
+		{
+			BackgroundTask(Region, Generation);
+			BackgroundBusy = false;
+		});
+	}
+}
+
 void TesseractImageToText::ProcessTask(IntRect Region, Result& Res)
 {
 	// https://tesseract-ocr.github.io/tessdoc/Examples_C++.html
@@ -99,7 +327,7 @@ void TesseractImageToText::ProcessTask(IntRect Region, Result& Res)
 
 	{
 		//AUG_PERF("CaptureScreen");
-		if (!ScreenCapture->Capture())
+		if (!ScreenCapture->Capture(Region)) // only selection is copied, not 33 MB of 4K desktop
 		{
 			loge("CaptureScreen");
 			return;
@@ -107,43 +335,290 @@ void TesseractImageToText::ProcessTask(IntRect Region, Result& Res)
 	}
 
 	cv::Mat& InMat = ScreenCapture->GetImage();
+	const IntRect Captured = ScreenCapture->GetRegion();
+	const float ImageScale = (Scale > 0 ? Scale : 1.0f);
 
-	cv::Mat TessMat;
-	{
-		//AUG_PERF("cvtColor");
-		cv::cvtColor(InMat, TessMat, cv::COLOR_BGRA2GRAY);
-	}
+	cv::Mat& TessMat = Preprocess(InMat);
 
 	#if AUG_DEBUG_OCR
 	cv::Mat DebugMat;
-	cv::cvtColor(InMat, DebugMat, cv::COLOR_BGRA2BGR);
+	cv::cvtColor(TessMat, DebugMat, cv::COLOR_GRAY2BGR);
 	#endif
 
 	//AUG_PERF("tess::TOTAL");
 
+	++Pass;
+	const bool Ok = Recognize(TessMat, cv::Rect(0, 0, TessMat.cols, TessMat.rows), nullptr, Res);
+	TrimCache();
+	if (!Ok)
+		return;
+
+	for (auto& Det : Res.Detections) // back to screen
 	{
-		//AUG_PERF("tess::SetImage");
-		TessApi->SetImage((uchar*)TessMat.data, TessMat.size().width, TessMat.size().height, TessMat.channels(), (int)TessMat.step1());
+		#if AUG_DEBUG_OCR
+			cv::rectangle(DebugMat, cv::Rect(Det.Rect.Left, Det.Rect.Top, Det.Rect.Width(), Det.Rect.Height()), cv::Scalar(0, 0, 255));
+		#endif
+
+		Det.Rect = ToScreen(Det.Rect, Captured, ImageScale);
+	}
+
+	#if AUG_DEBUG_OCR
+	cv::imshow("imshow", DebugMat);
+	#endif
+}
+
+void TesseractImageToText::BackgroundTask(IntRect Region, uint32_t Generation)
+{
+	using Clock = std::chrono::steady_clock;
+
+	if (!TessApi || PendingRequests > 0)
+		return;
+
+	const auto StartTime = Clock::now();
+	auto Budget = [&]()
+	{
+		if (ContinuousCpuPercent > 0 && ContinuousCpuPercent < 100)
+		{
+			const auto Now = Clock::now();
+			std::lock_guard<std::mutex> Lock(ContinuousMutex);
+			BackgroundIdleUntil = Now + (Now - StartTime) * (100 - ContinuousCpuPercent) / ContinuousCpuPercent;
+		}
+	};
+
+	if (!ScreenCapture->Capture(Region))
+	{
+		loge("CaptureScreen");
+		return;
+	}
+
+	const IntRect Captured = ScreenCapture->GetRegion();
+	const float ImageScale = (Scale > 0 ? Scale : 1.0f);
+	cv::Mat& TessMat = Preprocess(ScreenCapture->GetImage());
+
+	std::vector<cv::Rect> Bands;
+	{
+		//AUG_PERF("FindChangedBands");
+		Bands = FindChangedBands(TessMat);
+	}
+	if (Bands.empty())
+	{
+		Budget();
+		return;
+	}
+
+	++Pass;
+	std::vector<Detection> Added;
+	for (const auto& Band : Bands)
+	{
+		Result BandRes {};
+		if (!Recognize(TessMat, Band, &PendingRequests, BandRes))
+		{
+			Budget();
+			return; // preempted, diff not committed so next pass retries
+		}
+		std::move(BandRes.Detections.begin(), BandRes.Detections.end(), std::back_inserter(Added));
+	}
+	TrimCache();
+	std::swap(PrevDiffMat, DiffMat);
+
+	auto InBands = [&](const Detection& Det)
+	{
+		const int Center = (Det.Rect.Top + Det.Rect.Bottom) / 2;
+		return std::any_of(Bands.begin(), Bands.end(), [&](const cv::Rect& Band) { return Center >= Band.y && Center < Band.y + Band.height; });
+	};
+	auto Same = [](const Detection& A, const Detection& B)
+	{
+		return A.Rect.Left == B.Rect.Left && A.Rect.Top == B.Rect.Top && A.Rect.Right == B.Rect.Right && A.Rect.Bottom == B.Rect.Bottom && A.Text == B.Text;
+	};
+
+	// lines recognized again but unchanged are not part of delta
+	std::vector<Detection> Removed;
+	std::vector<Detection> Kept;
+	for (auto& Det : BackgroundDetections)
+	{
+		if (!InBands(Det))
+			Kept.push_back(std::move(Det));
+		else if (auto Iter = std::find_if(Added.begin(), Added.end(), [&](const Detection& New) { return Same(Det, New); }); Iter != Added.end())
+		{
+			Kept.push_back(std::move(*Iter));
+			Added.erase(Iter);
+		}
+		else
+			Removed.push_back(std::move(Det));
+	}
+
+	BackgroundDetections = std::move(Kept);
+	BackgroundDetections.insert(BackgroundDetections.end(), Added.begin(), Added.end());
+	std::sort(BackgroundDetections.begin(), BackgroundDetections.end(), [](const Detection& A, const Detection& B)
+	{
+		return (A.Rect.Top != B.Rect.Top ? A.Rect.Top < B.Rect.Top : A.Rect.Left < B.Rect.Left);
+	});
+
+	Budget();
+	if (Added.empty() && Removed.empty())
+		return; // cursor blink, selection highlight etc
+
+	Result Res {};
+	Res.Continuous = true;
+	for (auto Det : BackgroundDetections)
+	{
+		Res.Text.append(Det.Text);
+		Det.Rect = ToScreen(Det.Rect, Captured, ImageScale);
+		Res.Detections.push_back(std::move(Det));
+	}
+	for (auto& Det : Added)
+	{
+		Det.Rect = ToScreen(Det.Rect, Captured, ImageScale);
+		Res.Added.push_back(std::move(Det));
+	}
+	for (auto& Det : Removed)
+	{
+		Det.Rect = ToScreen(Det.Rect, Captured, ImageScale);
+		Res.Removed.push_back(std::move(Det));
+	}
+	for (const auto& Band : Bands)
+	{
+		Res.Changed.push_back(ToScreen({Band.x, Band.y, Band.x + Band.width, Band.y + Band.height}, Captured, ImageScale));
+	}
+
+	{
+		std::lock_guard<std::mutex> Lock(ContinuousMutex);
+		if (ContinuousStop || Generation != ContinuousGeneration)
+			return; // switched off or retargeted meanwhile
+	}
+
+	if (ResCallback)
+		ResCallback(Res);
+}
+
+// downscaled absdiff against last committed pass, changed rows become full width bands since text lines run horizontally
+std::vector<cv::Rect> TesseractImageToText::FindChangedBands(const cv::Mat& Mat)
+{
+	const int Factor = std::max(DiffScale, 1);
+	cv::resize(Mat, DiffMat, cv::Size(std::max(Mat.cols / Factor, 1), std::max(Mat.rows / Factor, 1)), 0, 0, cv::INTER_AREA);
+
+	std::vector<cv::Rect> Bands;
+	if (PrevDiffMat.empty() || PrevDiffMat.size() != DiffMat.size())
+	{
+		Bands.push_back(cv::Rect(0, 0, Mat.cols, Mat.rows));
+		return Bands;
+	}
+
+	cv::absdiff(DiffMat, PrevDiffMat, DeltaMat);
+	cv::threshold(DeltaMat, DeltaMat, DiffThreshold, 255, cv::THRESH_BINARY);
+	cv::reduce(DeltaMat, RowMat, 1, cv::REDUCE_MAX); // single column, nonzero: row changed
 
-		if (Region.Width() > 0 && Region.Height() > 0)
+	int Start = -1;
+	for (int y = 0; y <= RowMat.rows; ++y)
+	{
+		const bool Changed = (y < RowMat.rows && RowMat.at<uchar>(y, 0) != 0);
+		if (Changed && Start < 0)
+		{
+			Start = y;
+		}
+		else if (!Changed && Start >= 0)
 		{
-			TessApi->SetRectangle(Region.Left, Region.Top, Region.Width(), Region.Height());
+			// one diff row of padding, glyph may start above its cell
+			const int y1 = std::max((Start - 1) * Factor, 0);
+			const int y2 = std::min((y + 1) * Factor, Mat.rows);
+			if (!Bands.empty() && y1 <= Bands.back().y + Bands.back().height)
+				Bands.back().height = y2 - Bands.back().y;
+			else
+				Bands.push_back(cv::Rect(0, y1, Mat.cols, y2 - y1));
+			Start = -1;
 		}
 	}
 
+	// never cut through a known line, it would come back clipped (grown band may reach the next line, so until stable)
+	for (auto& Band : Bands)
+	{
+		for (bool Grown = true; Grown; )
+		{
+			Grown = false;
+			for (const auto& Det : BackgroundDetections)
+			{
+				if (Det.Rect.Bottom > Band.y && Det.Rect.Top < Band.y + Band.height
+					&& (Det.Rect.Top < Band.y || Det.Rect.Bottom > Band.y + Band.height))
+				{
+					const int y1 = std::max(std::min(Band.y, Det.Rect.Top), 0);
+					const int y2 = std::min(std::max(Band.y + Band.height, Det.Rect.Bottom), Mat.rows);
+					Grown |= (y1 != Band.y || y2 != Band.y + Band.height);
+					Band = cv::Rect(0, y1, Mat.cols, y2 - y1);
+				}
+			}
+		}
+	}
+
+	// bands grown over the same line would recognize it twice, merge what overlaps or touches
+	std::sort(Bands.begin(), Bands.end(), [](const cv::Rect& A, const cv::Rect& B) { return A.y < B.y; });
+	size_t NumMerged = 0;
+	for (size_t i = 0; i < Bands.size(); ++i)
+	{
+		if (NumMerged && Bands[i].y <= Bands[NumMerged - 1].y + Bands[NumMerged - 1].height)
+			Bands[NumMerged - 1] |= Bands[i];
+		else
+			Bands[NumMerged++] = Bands[i];
+	}
+	Bands.resize(NumMerged);
+
+	return Bands;
+}
+
+// Rect of Mat, detections in Mat coordinates, Preempt > 0 aborts (background passes)
+bool TesseractImageToText::Recognize(const cv::Mat& Mat, cv::Rect Rect, const std::atomic<int>* Preempt, Result& Res)
+{
+	const float ImageScale = (Scale > 0 ? Scale : 1.0f);
+	const bool Tiled = (TilePool && Rect.area() >= MinTiledArea * ImageScale * ImageScale);
+
+	uint64_t Key = 0;
+	if (CacheTiles)
+	{
+		//AUG_PERF("tess::HashImage"); // ~1 ms for 4K
+		Key = HashImage(Mat, Rect);
+		if (FindCached(Key, Rect.tl(), Res))
+			return true; // static screen, no layout analysis
+	}
+
+	if (Tiled ? !RecognizeTiled(Mat, Rect, Preempt, Res) : !RecognizeImage(*TessApi, Mat, Rect, Preempt, Res))
+		return false;
+
+	if (Key)
+		StoreCached(Key, Rect.tl(), Res);
+	return true;
+}
+
+// Rect of Mat, detections in Mat coordinates
+bool TesseractImageToText::RecognizeImage(tesseract::TessBaseAPI& Api, const cv::Mat& Mat, cv::Rect Rect, const std::atomic<int>* Preempt, Result& Res)
+{
+	{
+		//AUG_PERF("tess::SetImage");
+		const uchar* Data = Mat.ptr<uchar>(Rect.y) + Rect.x * Mat.channels(); // tesseract copies just this
+		Api.SetImage(Data, Rect.width, Rect.height, Mat.channels(), (int)Mat.step1());
+	}
+
 	{
 		//AUG_PERF("tess::Recognize");
-		int Error = TessApi->Recognize(nullptr);
-		if (Error)
+		tesseract::ETEXT_DESC Monitor;
+		if (Preempt)
 		{
-			loge("tess::Recognize Error={}", Error);
-			return;
+			Monitor.cancel = [](void* Flag, int) { return ((const std::atomic<int>*)Flag)->load() > 0; }; // polled between words
+			Monitor.cancel_this = (void*)Preempt;
+		}
+
+		int Error = Api.Recognize(Preempt ? &Monitor : nullptr);
+		const bool Preempted = (Preempt && Preempt->load() > 0);
+		if (Error || Preempted)
+		{
+			if (!Preempted)
+				loge("tess::Recognize Error={}", Error);
+			Api.Clear();
+			return false;
 		}
 	}
 
 	{
 		//AUG_PERF("tess::GetUTF8Text");
-		const char* Text = TessApi->GetUTF8Text();
+		const char* Text = Api.GetUTF8Text();
 		if (Text)
 		{
 			Res.Text.assign(Text);
@@ -151,7 +626,7 @@ void TesseractImageToText::ProcessTask(IntRect Region, Result& Res)
 		}
 	}
 
-	tesseract::ResultIterator* TessIter = TessApi->GetIterator();
+	tesseract::ResultIterator* TessIter = Api.GetIterator();
 	//tesseract::PageIteratorLevel TessLevel = tesseract::RIL_WORD;
 	tesseract::PageIteratorLevel TessLevel = tesseract::RIL_TEXTLINE;
 
@@ -168,15 +643,11 @@ void TesseractImageToText::ProcessTask(IntRect Region, Result& Res)
 				const float Confidence = TessIter->Confidence(TessLevel);
 
 				Detection Det;
-				Det.Rect = {x1, y1, x2, y2};
+				Det.Rect = {Rect.x + x1, Rect.y + y1, Rect.x + x2, Rect.y + y2};
 				Det.Confidence = Confidence;
 				Det.Text = TessWord;
 				Res.Detections.emplace_back(std::move(Det));
 
-				#if AUG_DEBUG_OCR
-					cv::rectangle(DebugMat, cv::Rect(x1, y1, x2 - x1, y2 - y1), cv::Scalar(0, 0, 255));
-				#endif
-
 				delete[] TessWord; // nice API clowns
 			}
 		}
@@ -185,14 +656,263 @@ void TesseractImageToText::ProcessTask(IntRect Region, Result& Res)
 		delete TessIter; // nice API clowns
 	}
 
-	TessApi->Clear();
+	Api.Clear();
+	return true;
+}
 
-	#if AUG_DEBUG_OCR
-	cv::imshow("imshow", DebugMat);
-	#endif
+// text lines of layout grouped into tiles, a couple per recognizer so uneven blocks still balance
+std::vector<TesseractImageToText::Tile> TesseractImageToText::FindTiles(const cv::Mat& Mat)
+{
+	struct Line
+	{
+		cv::Rect Rect;
+		int Block;
+	};
+
+	std::vector<Line> Lines;
+	{
+		//AUG_PERF("tess::AnalyseLayout");
+		TessApi->SetImage((uchar*)Mat.data, Mat.cols, Mat.rows, Mat.channels(), (int)Mat.step1());
+		std::unique_ptr<tesseract::PageIterator> Layout(TessApi->AnalyseLayout());
+
+		int Block = -1;
+		bool TextBlock = false;
+		if (Layout)
+		{
+			do
+			{
+				if (Layout->IsAtBeginningOf(tesseract::RIL_BLOCK))
+				{
+					++Block;
+					switch (Layout->BlockType())
+					{
+						case tesseract::PT_FLOWING_IMAGE:
+						case tesseract::PT_HEADING_IMAGE:
+						case tesseract::PT_PULLOUT_IMAGE:
+						case tesseract::PT_HORZ_LINE:
+						case tesseract::PT_VERT_LINE:
+						case tesseract::PT_NOISE:
+							TextBlock = false;
+							break;
+						default:
+							TextBlock = true;
+							break;
+					}
+				}
+
+				int x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+				if (TextBlock && Layout->BoundingBox(tesseract::RIL_TEXTLINE, &x1, &y1, &x2, &y2))
+				{
+					Lines.push_back({cv::Rect(x1, y1, x2 - x1, y2 - y1), Block});
+				}
+			}
+			while (Layout->Next(tesseract::RIL_TEXTLINE));
+		}
+		TessApi->Clear();
+	}
+
+	std::vector<Tile> Tiles;
+	if (Lines.empty())
+		return Tiles;
+
+	const size_t LinesPerTile = std::max<size_t>(1, (Lines.size() + Recognizers.size() * 2 - 1) / (Recognizers.size() * 2));
+	const cv::Rect Bounds(0, 0, Mat.cols, Mat.rows);
+	const int Pad = 4; // tesseract clips glyphs touching the border
+
+	size_t NumInTile = 0;
+	for (size_t i = 0; i < Lines.size(); ++i)
+	{
+		const bool NewBlock = (i == 0 || Lines[i].Block != Lines[i - 1].Block);
+		if (NewBlock || NumInTile == LinesPerTile)
+		{
+			Tiles.push_back({Lines[i].Rect, NewBlock && i > 0});
+			NumInTile = 0;
+		}
+		Tiles.back().Rect |= Lines[i].Rect;
+		++NumInTile;
+	}
+
+	for (auto& T : Tiles)
+	{
+		T.Rect = cv::Rect(T.Rect.x - Pad, T.Rect.y - Pad, T.Rect.width + Pad * 2, T.Rect.height + Pad * 2) & Bounds;
+	}
+
+	return Tiles;
+}
+
+bool TesseractImageToText::RecognizeTiled(const cv::Mat& Mat, cv::Rect Rect, const std::atomic<int>* Preempt, Result& Res)
+{
+	std::vector<Tile> Tiles = FindTiles(Mat(Rect));
+	for (auto& T : Tiles)
+	{
+		T.Rect.x += Rect.x;
+		T.Rect.y += Rect.y;
+	}
+
+	if (Tiles.empty()) // layout found no blocks, not the same as no text
+		return RecognizeImage(*TessApi, Mat, Rect, Preempt, Res);
+
+	std::vector<Result> TileResults(Tiles.size());
+	std::vector<uint64_t> Keys(Tiles.size());
+	std::vector<std::future<bool>> Futures(Tiles.size()); // invalid for cached tiles
+	std::vector<size_t> Submitted;
+	const int MaxInFlight = (Preempt ? ContinuousMaxInFlight : 0);
+
+	//AUG_PERF("tess::RecognizeTiled");
+	for (size_t i = 0; i < Tiles.size(); ++i)
+	{
+		if (Preempt && Preempt->load() > 0)
+			break;
+
+		if (CacheTiles)
+		{
+			Keys[i] = HashImage(Mat, Tiles[i].Rect);
+			if (FindCached(Keys[i], Tiles[i].Rect.tl(), TileResults[i]))
+				continue;
+		}
+
+		if (MaxInFlight > 0 && Submitted.size() >= (size_t)MaxInFlight)
+		{
+			Futures[Submitted[Submitted.size() - MaxInFlight]].wait(); // background pass leaves cores to everybody else
+		}
+
+		Futures[i] = TilePool->submit_task([this, &Mat, &Tile = Tiles[i], &TileRes = TileResults[i], Preempt]()
+		{
+			bool Ok = false;
+			if (tesseract::TessBaseAPI* Api = AcquireRecognizer())
+			{
+				Ok = RecognizeImage(*Api, Mat, Tile.Rect, Preempt, TileRes);
+				ReleaseRecognizer(Api);
+			}
+			return Ok;
+		});
+		Submitted.push_back(i);
+	}
+
+	size_t NumFailed = 0;
+	for (size_t i = 0; i < Tiles.size(); ++i)
+	{
+		if (!Futures[i].valid())
+			continue;
+		if (!Futures[i].get())
+			NumFailed++;
+		else if (Keys[i])
+			StoreCached(Keys[i], Tiles[i].Rect.tl(), TileResults[i]);
+	}
+
+	if (Preempt && Preempt->load() > 0)
+		return false;
+
+	if (NumFailed) // half a screen would look like the other half has no text
+	{
+		loge("tess::RecognizeTiled {} of {} tiles failed", NumFailed, Tiles.size());
+		return false;
+	}
+
+	// layout order is reading order
+	for (size_t i = 0; i < Tiles.size(); ++i)
+	{
+		if (Tiles[i].NewBlock && !Res.Text.empty())
+			Res.Text.append("\n");
+		Res.Text.append(TileResults[i].Text);
+		std::move(TileResults[i].Detections.begin(), TileResults[i].Detections.end(), std::back_inserter(Res.Detections));
+	}
+
+	return true;
+}
+
+// pixels and size, position is not part of the key
+uint64_t TesseractImageToText::HashImage(const cv::Mat& Mat, cv::Rect Rect)
+{
+	XXH3_state_t* Hash = HashState.get();
+	const int Dims[2] = { Rect.width, Rect.height };
+	XXH3_64bits_reset(Hash);
+	XXH3_64bits_update(Hash, Dims, sizeof(Dims));
+	for (int y = Rect.y; y < Rect.y + Rect.height; ++y)
+	{
+		XXH3_64bits_update(Hash, Mat.ptr<uchar>(y) + Rect.x * Mat.elemSize(), Rect.width * Mat.elemSize());
+	}
+	return XXH3_64bits_digest(Hash);
+}
+
+bool TesseractImageToText::FindCached(uint64_t Key, cv::Point Origin, Result& Res)
+{
+	auto Iter = TileCache.find(Key);
+	if (Iter == TileCache.end())
+		return false;
+
+	CachedTile& Cached = Iter->second;
+	Cached.LastPass = Pass;
+	Res.Text = Cached.Text;
+	for (const auto& Det : Cached.Detections)
+	{
+		Res.Detections.push_back({{Det.Rect.Left + Origin.x, Det.Rect.Top + Origin.y, Det.Rect.Right + Origin.x, Det.Rect.Bottom + Origin.y}, Det.Confidence, Det.Text});
+	}
+	return true;
+}
+
+void TesseractImageToText::StoreCached(uint64_t Key, cv::Point Origin, const Result& Res)
+{
+	CachedTile& Cached = TileCache[Key];
+	Cached.LastPass = Pass;
+	Cached.Text = Res.Text;
+	Cached.Detections.clear();
+	for (const auto& Det : Res.Detections)
+	{
+		Cached.Detections.push_back({{Det.Rect.Left - Origin.x, Det.Rect.Top - Origin.y, Det.Rect.Right - Origin.x, Det.Rect.Bottom - Origin.y}, Det.Confidence, Det.Text});
+	}
+}
+
+// tiles of current pass always stay, the rest goes oldest first
+void TesseractImageToText::TrimCache()
+{
+	if ((int)TileCache.size() <= CacheMaxTiles)
+		return;
+
+	std::vector<uint32_t> Passes;
+	Passes.reserve(TileCache.size());
+	for (const auto& [Key, Cached] : TileCache)
+		Passes.push_back(Cached.LastPass);
+
+	const size_t NumEvict = TileCache.size() - (size_t)std::max(CacheMaxTiles, 0);
+	std::nth_element(Passes.begin(), Passes.begin() + (NumEvict - 1), Passes.end());
+	const uint32_t MinPass = std::min(Passes[NumEvict - 1] + 1, Pass);
+
+	for (auto Iter = TileCache.begin(); Iter != TileCache.end(); )
+	{
+		if (Iter->second.LastPass < MinPass)
+			Iter = TileCache.erase(Iter);
+		else
+			++Iter;
+	}
+}
+
+// everything runs on the captured region only
+cv::Mat& TesseractImageToText::Preprocess(const cv::Mat& InMat)
+{
+	cv::Mat* Mat = &GrayMat;
+	{
+		//AUG_PERF("cvtColor");
+		cv::cvtColor(InMat, GrayMat, cv::COLOR_BGRA2GRAY);
+	}
+
+	if (Scale > 0 && Scale != 1.0f)
+	{
+		//AUG_PERF("resize");
+		cv::resize(GrayMat, ScaledMat, cv::Size(), Scale, Scale, (Scale > 1.0f ? cv::INTER_CUBIC : cv::INTER_AREA));
+		Mat = &ScaledMat;
+	}
+
+	if (Binarize)
+	{
+		//AUG_PERF("threshold");
+		cv::threshold(*Mat, *Mat, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+	}
+
+	return *Mat;
 }
 
-IImageToText* IImageToText::CreateInstance()
+IImageToText* IImageToText::CreateInstance(IScreenCapture* Capture)
 {
-	return new TesseractImageToText();
+	return new TesseractImageToText(Capture);
 }
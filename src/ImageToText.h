@@ -1,12 +1,14 @@
 #pragma once
 
-#include "AUGCore.h"
+#include "IniFile.h"
+
+class IScreenCapture;
 
 class IImageToText
 {
 public:
 
-	static IImageToText* CreateInstance();
+	static IImageToText* CreateInstance(IScreenCapture* Capture = nullptr); // takes ownership, null: desktop
 
 	struct Detection
 	{
@@ -20,6 +22,12 @@ public:
 		std::vector<Detection> Detections;
 		std::string Text;
 
+		// continuous mode, delta against previous continuous result, Detections/Text still hold everything
+		bool Continuous = false;
+		std::vector<Detection> Added;
+		std::vector<Detection> Removed;
+		std::vector<IntRect> Changed; // recognized again
+
 		AUG_MOVABLE_NONCOPYABLE(Result);
 	};
 
@@ -28,5 +36,8 @@ public:
 	virtual ~IImageToText() {}
 	virtual bool Init(ResultCallback Callback) = 0;
 	virtual void Release() = 0;
-	virtual void Process(IntRect Region = {}) = 0;
+	virtual void Serialize(IniFile& Config, bool Save) = 0;
+	virtual void Process(IntRect Region = {}) = 0; // screen coordinates, empty: whole screen, detections come back in screen coordinates
+	virtual void SetContinuous(bool Enable, IntRect Region = {}) = 0; // background passes over changed parts of Region, Process preempts them
+	virtual bool IsContinuous() const = 0;
 };
@@ -0,0 +1,110 @@
+#include "MappedFile.h"
+
+#include <mutex>
+#include <unordered_map>
+
+#if defined(_WIN32)
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+static std::mutex _CacheMutex;
+static std::unordered_map<std::string, std::weak_ptr<MappedFile>> _Cache;
+
+std::shared_ptr<MappedFile> MappedFile::Open(const std::string& Path)
+{
+	std::lock_guard<std::mutex> Lock(_CacheMutex);
+
+	if (auto Iter = _Cache.find(Path); Iter != _Cache.end())
+	{
+		if (auto File = Iter->second.lock())
+			return File;
+	}
+
+	std::shared_ptr<MappedFile> File(new MappedFile());
+	if (!File->Map(Path))
+	{
+		loge("Failed to map {}", Path);
+		return {};
+	}
+
+	_Cache[Path] = File;
+	return File;
+}
+
+MappedFile::~MappedFile()
+{
+	Unmap();
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::Map(const std::string& Path)
+{
+	_path = Path;
+
+	HANDLE File = CreateFileA(Path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (File == INVALID_HANDLE_VALUE)
+		return false;
+	_file = File;
+
+	LARGE_INTEGER Size {};
+	if (!GetFileSizeEx(File, &Size) || !Size.QuadPart)
+		return false;
+	_size = (size_t)Size.QuadPart;
+
+	_mapping = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!_mapping)
+		return false;
+
+	_mem = (const uint8_t*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+	return _mem != nullptr;
+}
+
+void MappedFile::Unmap()
+{
+	if (_mem) { UnmapViewOfFile(_mem); _mem = nullptr; }
+	if (_mapping) { CloseHandle(_mapping); _mapping = nullptr; }
+	if (_file) { CloseHandle(_file); _file = nullptr; }
+	_size = 0;
+}
+
+#else
+
+bool MappedFile::Map(const std::string& Path)
+{
+	_path = Path;
+
+	const int Fd = open(Path.c_str(), O_RDONLY);
+	if (Fd < 0)
+		return false;
+
+	struct stat St {};
+	if (fstat(Fd, &St) != 0 || !St.st_size)
+	{
+		close(Fd);
+		return false;
+	}
+	_size = (size_t)St.st_size;
+
+	void* Mem = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, Fd, 0);
+	close(Fd); // mapping keeps file alive
+	if (Mem == MAP_FAILED)
+		return false;
+
+	madvise(Mem, _size, MADV_SEQUENTIAL);
+	_mem = (const uint8_t*)Mem;
+	return true;
+}
+
+void MappedFile::Unmap()
+{
+	if (_mem) { munmap((void*)_mem, _size); _mem = nullptr; }
+	_size = 0;
+}
+
+#endif
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "AUGCore.h"
+#include <atomic>
+
+// READ ONLY FILE MAPPING, SHARED BY EVERYONE WHO OPENS SAME PATH
+// Pages come from OS file cache, second open of 500 MB model costs nothing.
+
+class MappedFile
+{
+public:
+
+	static std::shared_ptr<MappedFile> Open(const std::string& Path);
+
+	~MappedFile();
+	AUG_NO_COPY(MappedFile);
+	AUG_NO_MOVE(MappedFile);
+
+	const uint8_t* data() const { return _mem; }
+	size_t size() const { return _size; }
+	const std::string& path() const { return _path; }
+
+private:
+
+	MappedFile() {}
+	bool Map(const std::string& Path);
+	void Unmap();
+
+	std::string _path;
+	const uint8_t* _mem = nullptr;
+	size_t _size = 0;
+	void* _file = nullptr;
+	void* _mapping = nullptr;
+};
+
+// sequential reader over mapped file, shape of whisper_model_loader and friends
+struct MappedFileReader
+{
+	std::shared_ptr<MappedFile> File;
+	size_t Offset = 0;
+	const std::atomic<int>* CancelFlag = nullptr; // read returns nothing once set
+
+	size_t Read(void* Dst, size_t Size)
+	{
+		if (!File || (CancelFlag && *CancelFlag))
+			return 0;
+		const size_t Num = std::min(Size, File->size() - Offset);
+		memcpy(Dst, File->data() + Offset, Num);
+		Offset += Num;
+		return Num;
+	}
+
+	bool Eof() const { return !File || Offset >= File->size(); }
+};
@@ -0,0 +1,242 @@
+#include "ResponseCache.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+// file: magic, version, num deltas, content size, deltas, content
+static constexpr uint32_t CacheMagic = 0x52475541; // AUGR
+static constexpr uint32_t CacheVersion = 1;
+
+bool ResponseCache::Init(size_t InMaxEntries, size_t InMaxMemoryBytes, const std::string& InDir, size_t InMaxDiskBytes)
+{
+	Release();
+
+	MaxEntries = std::max<size_t>(InMaxEntries, 1);
+	MaxMemoryBytes = InMaxMemoryBytes;
+	MaxDiskBytes = InMaxDiskBytes;
+	Dir = InDir;
+
+	if (Dir.empty())
+		return true;
+
+	std::error_code Ec;
+	fs::create_directories(Dir, Ec);
+	if (!fs::is_directory(Dir, Ec))
+	{
+		loge("ResponseCache: invalid dir {}", Dir);
+		Dir.clear();
+		return false;
+	}
+
+	// rebuild disk LRU from file times, last hit touches the file
+	std::vector<std::pair<fs::file_time_type, uint64_t>> Files;
+	std::vector<fs::path> Stale;
+	for (const auto& File : fs::directory_iterator(Dir, Ec))
+	{
+		if (!File.is_regular_file(Ec))
+			continue;
+
+		if (File.path().extension() == ".tmp" && File.path().stem().extension() == ".bin") // crashed in the middle of Store
+		{
+			Stale.push_back(File.path());
+			continue;
+		}
+
+		if (File.path().extension() != ".bin")
+			continue;
+
+		const std::string Stem = File.path().stem().string();
+		char* End = nullptr;
+		const uint64_t Key = strtoull(Stem.c_str(), &End, 16);
+		if (Stem.size() != 16 || *End)
+			continue;
+
+		Files.emplace_back(File.last_write_time(Ec), Key);
+		Disk[Key].Size = (size_t)File.file_size(Ec);
+		DiskBytes += Disk[Key].Size;
+	}
+
+	for (const auto& Path : Stale)
+	{
+		fs::remove(Path, Ec);
+	}
+
+	std::sort(Files.begin(), Files.end(), [](const auto& A, const auto& B) { return A.first > B.first; });
+	for (const auto& [Time, Key] : Files)
+	{
+		DiskOrder.push_back(Key);
+		Disk[Key].Order = std::prev(DiskOrder.end());
+	}
+
+	Trim();
+	logi("ResponseCache: {} answers on disk, {} KB", Disk.size(), DiskBytes / 1024);
+	return true;
+}
+
+void ResponseCache::Release()
+{
+	Memory.clear();
+	MemoryOrder.clear();
+	MemoryBytes = 0;
+	Disk.clear();
+	DiskOrder.clear();
+	DiskBytes = 0;
+}
+
+ResponseCache::EntryPtr ResponseCache::Find(uint64_t Key)
+{
+	if (auto Iter = Memory.find(Key); Iter != Memory.end())
+	{
+		MemoryOrder.splice(MemoryOrder.begin(), MemoryOrder, Iter->second.Order);
+		return Iter->second.Value;
+	}
+
+	auto Iter = Disk.find(Key);
+	if (Iter == Disk.end())
+		return {};
+
+	EntryPtr Value = Load(Key);
+	if (!Value) // broken or deleted behind our back
+	{
+		std::error_code Ec;
+		fs::remove(GetPath(Key), Ec);
+		DiskBytes -= Iter->second.Size;
+		DiskOrder.erase(Iter->second.Order);
+		Disk.erase(Iter);
+		return {};
+	}
+
+	DiskOrder.splice(DiskOrder.begin(), DiskOrder, Iter->second.Order);
+	std::error_code Ec;
+	fs::last_write_time(GetPath(Key), fs::file_time_type::clock::now(), Ec);
+
+	Remember(Key, Value);
+	Trim();
+	return Value;
+}
+
+void ResponseCache::Insert(uint64_t Key, Entry Value)
+{
+	auto Shared = std::make_shared<const Entry>(std::move(Value));
+
+	if (!Dir.empty() && !Disk.count(Key) && Store(Key, *Shared))
+	{
+		DiskOrder.push_front(Key);
+		auto& Item = Disk[Key];
+		Item.Size = 4 * sizeof(uint32_t) + GetSize(*Shared);
+		Item.Order = DiskOrder.begin();
+		DiskBytes += Item.Size;
+	}
+
+	Remember(Key, std::move(Shared));
+	Trim();
+}
+
+void ResponseCache::Remember(uint64_t Key, EntryPtr Value)
+{
+	if (auto Iter = Memory.find(Key); Iter != Memory.end())
+	{
+		MemoryBytes -= GetSize(*Iter->second.Value);
+		MemoryOrder.erase(Iter->second.Order);
+		Memory.erase(Iter);
+	}
+
+	MemoryBytes += GetSize(*Value);
+	MemoryOrder.push_front(Key);
+	Memory[Key] = { std::move(Value), MemoryOrder.begin() };
+}
+
+void ResponseCache::Trim()
+{
+	while (!MemoryOrder.empty() && (Memory.size() > MaxEntries || MemoryBytes > MaxMemoryBytes))
+	{
+		auto Iter = Memory.find(MemoryOrder.back());
+		MemoryBytes -= GetSize(*Iter->second.Value);
+		Memory.erase(Iter);
+		MemoryOrder.pop_back();
+	}
+
+	while (!DiskOrder.empty() && DiskBytes > MaxDiskBytes)
+	{
+		const uint64_t Key = DiskOrder.back();
+		std::error_code Ec;
+		fs::remove(GetPath(Key), Ec);
+		DiskBytes -= Disk[Key].Size;
+		Disk.erase(Key);
+		DiskOrder.pop_back();
+	}
+}
+
+std::string ResponseCache::GetPath(uint64_t Key) const
+{
+	return fmt::format("{}/{:016x}.bin", Dir, Key);
+}
+
+ResponseCache::EntryPtr ResponseCache::Load(uint64_t Key)
+{
+	const std::string Path = GetPath(Key);
+	std::error_code Ec;
+	const uint64_t FileSize = (uint64_t)fs::file_size(Path, Ec);
+	if (Ec)
+		return {};
+
+	FILE* fd = fopen(Path.c_str(), "rb");
+	if (!fd)
+		return {};
+
+	auto Value = std::make_shared<Entry>();
+	uint32_t Header[4] = {};
+	bool Ok = (fread(Header, sizeof(Header), 1, fd) == 1 && Header[0] == CacheMagic && Header[1] == CacheVersion);
+
+	// sizes must add up to the file before anything is allocated, garbage header could ask for gigabytes
+	Ok = Ok && (sizeof(Header) + (uint64_t)Header[2] * sizeof(uint32_t) + Header[3] == FileSize);
+	if (Ok)
+	{
+		Value->Deltas.resize(Header[2]);
+		Value->Content.resize(Header[3]);
+		Ok = (Value->Deltas.empty() || fread(Value->Deltas.data(), Value->Deltas.size() * sizeof(uint32_t), 1, fd) == 1)
+			&& (Value->Content.empty() || fread(Value->Content.data(), Value->Content.size(), 1, fd) == 1);
+	}
+	fclose(fd);
+
+	// offsets must stay inside content, replay trusts them
+	for (size_t i = 0; Ok && i < Value->Deltas.size(); ++i)
+		Ok = (Value->Deltas[i] <= Value->Content.size() && (i == 0 || Value->Deltas[i] >= Value->Deltas[i - 1]));
+
+	return Ok ? Value : EntryPtr();
+}
+
+bool ResponseCache::Store(uint64_t Key, const Entry& Value)
+{
+	const std::string Path = GetPath(Key);
+	const std::string TmpPath = Path + ".tmp";
+
+	FILE* fd = fopen(TmpPath.c_str(), "wb");
+	if (!fd)
+	{
+		loge("ResponseCache: fopen {}", TmpPath);
+		return false;
+	}
+
+	const uint32_t Header[4] = { CacheMagic, CacheVersion, (uint32_t)Value.Deltas.size(), (uint32_t)Value.Content.size() };
+	bool Ok = fwrite(Header, sizeof(Header), 1, fd) == 1;
+	if (Ok && !Value.Deltas.empty())
+		Ok = fwrite(Value.Deltas.data(), Value.Deltas.size() * sizeof(uint32_t), 1, fd) == 1;
+	if (Ok && !Value.Content.empty())
+		Ok = fwrite(Value.Content.data(), Value.Content.size(), 1, fd) == 1;
+	Ok = (fclose(fd) == 0) && Ok;
+
+	std::error_code Ec;
+	if (Ok)
+		fs::rename(TmpPath, Path, Ec); // readers never see half a file
+	if (!Ok || Ec)
+	{
+		fs::remove(TmpPath, Ec);
+		loge("ResponseCache: write {}", Path);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "AUGCore.h"
+#include <list>
+#include <unordered_map>
+
+// FINISHED ASSISTANT ANSWERS KEYED BY REQUEST HASH
+// Memory LRU in front of optional directory with one file per answer, both limited by count/bytes.
+// Not thread safe, owner calls it from one thread.
+
+class ResponseCache
+{
+public:
+
+	struct Entry
+	{
+		std::string Content;
+		std::vector<uint32_t> Deltas; // end offset of every streamed delta, replay keeps the original chunking
+	};
+	using EntryPtr = std::shared_ptr<const Entry>;
+
+	~ResponseCache() { Release(); }
+
+	bool Init(size_t MaxEntries, size_t MaxMemoryBytes, const std::string& Dir = {}, size_t MaxDiskBytes = 0); // empty Dir: memory only
+	void Release();
+
+	EntryPtr Find(uint64_t Key);
+	void Insert(uint64_t Key, Entry Value);
+
+	size_t GetNumEntries() const { return Memory.size(); }
+	size_t GetMemoryBytes() const { return MemoryBytes; }
+	size_t GetDiskBytes() const { return DiskBytes; }
+
+private:
+
+	static size_t GetSize(const Entry& Value) { return Value.Content.size() + Value.Deltas.size() * sizeof(uint32_t); }
+	std::string GetPath(uint64_t Key) const;
+	EntryPtr Load(uint64_t Key);
+	bool Store(uint64_t Key, const Entry& Value);
+	void Remember(uint64_t Key, EntryPtr Value);
+	void Trim();
+
+	struct MemoryItem
+	{
+		EntryPtr Value;
+		std::list<uint64_t>::iterator Order;
+	};
+
+	struct DiskItem
+	{
+		size_t Size = 0;
+		std::list<uint64_t>::iterator Order;
+	};
+
+	size_t MaxEntries = 0;
+	size_t MaxMemoryBytes = 0;
+	size_t MaxDiskBytes = 0;
+	std::string Dir;
+
+	std::unordered_map<uint64_t, MemoryItem> Memory;
+	std::list<uint64_t> MemoryOrder; // most recent first
+	size_t MemoryBytes = 0;
+
+	std::unordered_map<uint64_t, DiskItem> Disk;
+	std::list<uint64_t> DiskOrder; // most recent first
+	size_t DiskBytes = 0;
+};
@@ -0,0 +1,187 @@
+#pragma once
+
+#include "AUGCore.h"
+#include <atomic>
+
+// SINGLE PRODUCER, SINGLE CONSUMER, ZERO LOCKS, ZERO MALLOC AFTER INIT
+// Positions are absolute (never wrap), storage index is Pos & Mask.
+// Storage is followed by a mirror of its first MaxSpan elements, so any span up to MaxSpan is contiguous.
+
+template<typename T>
+struct TRingBuffer
+{
+	static constexpr size_t CacheLine = 64;
+
+protected:
+	T* _mem = nullptr;
+	size_t _cap = 0;
+	size_t _mask = 0;
+	size_t _span = 0;
+
+	alignas(CacheLine) std::atomic<uint64_t> _write {0}; // producer owned
+	alignas(CacheLine) std::atomic<uint64_t> _read {0}; // consumer owned
+	alignas(CacheLine) std::atomic<uint64_t> _overflow {0};
+
+	void store(size_t idx, const T* elems, size_t num_elems) // no wrap
+	{
+		memcpy(_mem + idx, elems, num_elems * sizeof(T));
+		if (idx < _span) // keep mirror in sync
+		{
+			const size_t num_mirror = std::min(num_elems, _span - idx);
+			memcpy(_mem + _cap + idx, elems, num_mirror * sizeof(T));
+		}
+	}
+
+public:
+	TRingBuffer() noexcept {}
+	~TRingBuffer() { dealloc(); }
+
+	AUG_NO_COPY(TRingBuffer);
+	AUG_NO_MOVE(TRingBuffer);
+
+	bool init(size_t min_elems, size_t max_span)
+	{
+		dealloc();
+
+		size_t cap = 1;
+		while (cap < min_elems || cap < max_span) { cap <<= 1; }
+
+		_mem = (T*)_aligned_malloc((cap + max_span) * sizeof(T), CacheLine);
+		if (!_mem)
+			return false;
+
+		_cap = cap;
+		_mask = cap - 1;
+		_span = max_span;
+		reset();
+		return true;
+	}
+
+	void dealloc()
+	{
+		if (_mem)
+		{
+			_aligned_free(_mem);
+			_mem = nullptr;
+		}
+		_cap = 0;
+		_mask = 0;
+		_span = 0;
+	}
+
+	void reset() // NOT THREAD SAFE
+	{
+		_write.store(0);
+		_read.store(0);
+		_overflow.store(0);
+	}
+
+	// PRODUCER
+
+	// all or nothing, returns false and counts dropped elements when consumer falls behind
+	bool write(const T* elems, size_t num_elems)
+	{
+		if (!num_elems)
+			return true;
+
+		const uint64_t w = _write.load(std::memory_order_relaxed);
+		const uint64_t r = _read.load(std::memory_order_acquire);
+
+		if (num_elems > _cap - (size_t)(w - r))
+		{
+			_overflow.fetch_add(num_elems, std::memory_order_relaxed);
+			return false;
+		}
+
+		const size_t idx = (size_t)(w & _mask);
+		const size_t num_first = std::min(num_elems, _cap - idx);
+		store(idx, elems, num_first);
+		if (num_first < num_elems)
+		{
+			store(0, elems + num_first, num_elems - num_first);
+		}
+
+		_write.store(w + num_elems, std::memory_order_release);
+		return true;
+	}
+
+	// contiguous space for up to max_elems, may run into mirror, nullptr when full (producer reports what it really lost with drop)
+	T* begin_write(size_t max_elems)
+	{
+		const uint64_t w = _write.load(std::memory_order_relaxed);
+		const uint64_t r = _read.load(std::memory_order_acquire);
+
+		if (max_elems > _span || max_elems > _cap - (size_t)(w - r))
+			return nullptr;
+
+		return _mem + (size_t)(w & _mask);
+	}
+
+	// count elements that didn't fit after begin_write failed
+	void drop(size_t num_elems)
+	{
+		_overflow.fetch_add(num_elems, std::memory_order_relaxed);
+	}
+
+	// publish num_elems written at begin_write pointer
+	void end_write(size_t num_elems)
+	{
+		if (!num_elems)
+			return;
+
+		const uint64_t w = _write.load(std::memory_order_relaxed);
+		const size_t idx = (size_t)(w & _mask);
+		const size_t end = idx + num_elems;
+
+		// part that landed in mirror belongs to the head, mirror itself is already right
+		if (end > _cap)
+		{
+			memcpy(_mem, _mem + _cap, (end - _cap) * sizeof(T));
+		}
+
+		// part that landed in head needs a mirror copy
+		if (idx < _span)
+		{
+			const size_t num_mirror = std::min(end, _span) - idx;
+			memcpy(_mem + _cap + idx, _mem + idx, num_mirror * sizeof(T));
+		}
+
+		_write.store(w + num_elems, std::memory_order_release);
+	}
+
+	// CONSUMER
+
+	// contiguous view of [pos, pos + num_elems), nullptr if not available
+	const T* span(uint64_t pos, size_t num_elems) const
+	{
+		if (num_elems > _span)
+			return nullptr;
+
+		const uint64_t r = _read.load(std::memory_order_relaxed);
+		const uint64_t w = _write.load(std::memory_order_acquire);
+
+		if (pos < r || pos + num_elems > w)
+			return nullptr;
+
+		return _mem + (size_t)(pos & _mask);
+	}
+
+	// release everything before pos back to producer
+	void consume(uint64_t pos)
+	{
+		const uint64_t r = _read.load(std::memory_order_relaxed);
+		const uint64_t w = _write.load(std::memory_order_acquire);
+		pos = std::min(pos, w);
+		if (pos > r)
+		{
+			_read.store(pos, std::memory_order_release);
+		}
+	}
+
+	uint64_t write_pos() const { return _write.load(std::memory_order_acquire); }
+	uint64_t read_pos() const { return _read.load(std::memory_order_acquire); }
+	uint64_t overflow() const { return _overflow.load(std::memory_order_relaxed); }
+	size_t size() const { return (size_t)(write_pos() - read_pos()); }
+	size_t cap() const { return _cap; }
+	size_t max_span() const { return _span; }
+};
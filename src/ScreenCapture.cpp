@@ -1,5 +1,159 @@
 #include "ScreenCapture.h"
 
+#include <opencv2/opencv.hpp>
+#include <filesystem>
+#include <deque>
+#include <mutex>
+
+// IMAGES INSTEAD OF SCREEN, OCR WITHOUT DESKTOP (LINUX, CI, BENCHMARKS)
+// Every Capture takes the next pushed image, else the next file, else stays on the current one like a static screen.
+// Image is the screen: Region is clipped to it, GetRegion is in image coordinates.
+
+class ImageScreenCapture : public IScreenCapture
+{
+public:
+
+	ImageScreenCapture(const std::string& InPath) : Path(InPath) {}
+	virtual ~ImageScreenCapture() override { Release(); }
+	virtual bool Init() override;
+	virtual void Release() override;
+	virtual bool Capture(IntRect Region) override;
+	virtual cv::Mat& GetImage() override { return BgrMat; }
+	virtual IntRect GetRegion() const override { return CapturedRegion; }
+	virtual bool PushImage(const cv::Mat& Image) override;
+
+private:
+
+	static bool ToBgra(const cv::Mat& Image, cv::Mat& Out);
+
+	std::string Path;
+	std::vector<std::string> Files;
+	size_t NextFile = 0;
+
+	std::deque<cv::Mat> Queue;
+	std::mutex QueueMutex;
+
+	cv::Mat Frame; // current "screen"
+	cv::Mat BgrMat; // region of Frame, no copy
+	IntRect CapturedRegion {};
+};
+
+bool ImageScreenCapture::Init()
+{
+	namespace fs = std::filesystem;
+
+	Files.clear();
+	NextFile = 0;
+
+	if (Path.empty())
+		return true;
+
+	std::error_code Ec;
+	if (fs::is_directory(Path, Ec))
+	{
+		for (const auto& File : fs::directory_iterator(Path, Ec))
+		{
+			std::string Ext = File.path().extension().string();
+			std::transform(Ext.begin(), Ext.end(), Ext.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+			if (File.is_regular_file(Ec) && (Ext == ".png" || Ext == ".jpg" || Ext == ".jpeg" || Ext == ".bmp" || Ext == ".tif" || Ext == ".tiff" || Ext == ".webp"))
+				Files.push_back(File.path().string());
+		}
+		std::sort(Files.begin(), Files.end());
+	}
+	else if (fs::is_regular_file(Path, Ec))
+	{
+		Files.push_back(Path);
+	}
+
+	if (Files.empty())
+	{
+		loge("ImageScreenCapture: no images in {}", Path);
+		return false;
+	}
+
+	logi("ImageScreenCapture: {} images", Files.size());
+	return true;
+}
+
+void ImageScreenCapture::Release()
+{
+	BgrMat.release();
+	Frame.release();
+	Files.clear();
+	std::lock_guard<std::mutex> Lock(QueueMutex);
+	Queue.clear();
+}
+
+// pipeline expects what BitBlt gives
+bool ImageScreenCapture::ToBgra(const cv::Mat& Image, cv::Mat& Out)
+{
+	switch (Image.channels())
+	{
+		case 1: cv::cvtColor(Image, Out, cv::COLOR_GRAY2BGRA); return true;
+		case 3: cv::cvtColor(Image, Out, cv::COLOR_BGR2BGRA); return true;
+		case 4: Image.copyTo(Out); return true;
+	}
+	return false;
+}
+
+bool ImageScreenCapture::PushImage(const cv::Mat& Image)
+{
+	cv::Mat Bgra;
+	if (Image.empty() || !ToBgra(Image, Bgra))
+		return false;
+
+	std::lock_guard<std::mutex> Lock(QueueMutex);
+	Queue.push_back(std::move(Bgra));
+	return true;
+}
+
+bool ImageScreenCapture::Capture(IntRect Region)
+{
+	{
+		std::lock_guard<std::mutex> Lock(QueueMutex);
+		if (!Queue.empty())
+		{
+			Frame = std::move(Queue.front());
+			Queue.pop_front();
+			NextFile = Files.size(); // pushed images win over the rest of the files
+		}
+	}
+
+	if (NextFile < Files.size())
+	{
+		const std::string& Filename = Files[NextFile++];
+		cv::Mat Image = cv::imread(Filename, cv::IMREAD_COLOR);
+		if (Image.empty() || !ToBgra(Image, Frame))
+		{
+			loge("ImageScreenCapture: imread {}", Filename);
+			return false;
+		}
+	}
+
+	if (Frame.empty())
+		return false;
+
+	IntRect Rc {0, 0, Frame.cols, Frame.rows};
+	if (Region.Width() > 0 && Region.Height() > 0)
+	{
+		Rc.Left = std::max(Region.Left, 0);
+		Rc.Top = std::max(Region.Top, 0);
+		Rc.Right = std::min(Region.Right, Frame.cols);
+		Rc.Bottom = std::min(Region.Bottom, Frame.rows);
+		if (Rc.Width() <= 0 || Rc.Height() <= 0)
+			return false;
+	}
+
+	BgrMat = Frame(cv::Rect(Rc.Left, Rc.Top, Rc.Width(), Rc.Height()));
+	CapturedRegion = Rc;
+	return true;
+}
+
+IScreenCapture* IScreenCapture::CreateImageInstance(const std::string& Path)
+{
+	return new ImageScreenCapture(Path);
+}
+
 #if defined(_WIN32)
 
 #include <windows.h>
@@ -13,18 +167,22 @@ public:
 	virtual ~BltScreenCapture() override { Release(); }
 	virtual bool Init() override;
 	virtual void Release() override;
-	virtual bool Capture() override;
+	virtual bool Capture(IntRect Region) override;
 	virtual cv::Mat& GetImage() override { return BgrMat; }
+	virtual IntRect GetRegion() const override { return CapturedRegion; }
 
 private:
 
+	bool Resize(int NewWidth, int NewHeight);
+
 	HWND Window  {};
 	HDC WindowDC  {};
 	HDC CompatibleDC  {};
 	HBITMAP Bitmap  {};
-	BITMAPINFOHEADER BitmapInfo {};
+	HGDIOBJ DefaultBitmap {};
 	int Height = 0, Width = 0, SrcHeight = 0, SrcWidth = 0;
-	cv::Mat BgrMat;
+	IntRect CapturedRegion {};
+	cv::Mat BgrMat; // header over DIB section bits, no GetDIBits copy
 };
 
 bool BltScreenCapture::Init()
@@ -42,35 +200,13 @@ bool BltScreenCapture::Init()
 		CompatibleDC = CreateCompatibleDC(WindowDC);
 		GUARD_BREAK(CompatibleDC, "CreateCompatibleDC");
 
-		int OldMode = SetStretchBltMode(CompatibleDC, COLORONCOLOR);
-		GUARD_BREAK(OldMode != 0, "SetStretchBltMode");
-
 		RECT WindowRect {};
 		GetClientRect(Window, &WindowRect);
 
 		SrcHeight = WindowRect.bottom;
 		SrcWidth = WindowRect.right;
-		Height = WindowRect.bottom;
-		Width = WindowRect.right;
-
-		ZeroMemory(&BitmapInfo, sizeof(BitmapInfo));
-		BitmapInfo.biSize = sizeof(BITMAPINFOHEADER);
-		BitmapInfo.biWidth = Width;
-		BitmapInfo.biHeight = -Height; // upside down or not
-		BitmapInfo.biPlanes = 1;
-		BitmapInfo.biBitCount = 32;
-		BitmapInfo.biCompression = BI_RGB;
-		BitmapInfo.biSizeImage = 0;
-		BitmapInfo.biXPelsPerMeter = 0;
-		BitmapInfo.biYPelsPerMeter = 0;
-		BitmapInfo.biClrUsed = 0;
-		BitmapInfo.biClrImportant = 0;
-
-		Bitmap = CreateCompatibleBitmap(WindowDC, Width, Height);
-		GUARD_BREAK(Bitmap, "CreateCompatibleBitmap");
-
-		SelectObject(CompatibleDC, Bitmap);
-		BgrMat.create(Height, Width, CV_8UC4);
+
+		GUARD_BREAK(Resize(SrcWidth, SrcHeight), "CreateDIBSection");
 
 		return true;
 	}
@@ -80,25 +216,74 @@ bool BltScreenCapture::Init()
 	return false;
 }
 
-bool BltScreenCapture::Capture()
+// bitmap follows capture size, same size region reuses it
+bool BltScreenCapture::Resize(int NewWidth, int NewHeight)
 {
+	if (Bitmap && Width == NewWidth && Height == NewHeight)
+		return true;
+
+	BgrMat.release(); // points into the bitmap
 	if (Bitmap)
 	{
-		if (StretchBlt(CompatibleDC, 0, 0, Width, Height, WindowDC, 0, 0, SrcWidth, SrcHeight, SRCCOPY))
-		{
-			if (GetDIBits(CompatibleDC, Bitmap, 0, Height, BgrMat.data, (BITMAPINFO*)&BitmapInfo, DIB_RGB_COLORS))
-			{
-				return true;
-			}
-		}
+		SelectObject(CompatibleDC, DefaultBitmap);
+		DeleteObject(Bitmap);
+		Bitmap = nullptr;
 	}
 
-	return false;
+	BITMAPINFO Info {};
+	Info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+	Info.bmiHeader.biWidth = NewWidth;
+	Info.bmiHeader.biHeight = -NewHeight; // top-down
+	Info.bmiHeader.biPlanes = 1;
+	Info.bmiHeader.biBitCount = 32; // rows always DWORD aligned
+	Info.bmiHeader.biCompression = BI_RGB;
+
+	void* Bits = nullptr;
+	Bitmap = CreateDIBSection(WindowDC, &Info, DIB_RGB_COLORS, &Bits, NULL, 0);
+	if (!Bitmap || !Bits)
+	{
+		Bitmap = nullptr;
+		return false;
+	}
+
+	DefaultBitmap = SelectObject(CompatibleDC, Bitmap);
+	Width = NewWidth;
+	Height = NewHeight;
+	BgrMat = cv::Mat(Height, Width, CV_8UC4, Bits);
+	return true;
+}
+
+bool BltScreenCapture::Capture(IntRect Region)
+{
+	if (!CompatibleDC)
+		return false;
+
+	IntRect Rc {0, 0, SrcWidth, SrcHeight};
+	if (Region.Width() > 0 && Region.Height() > 0)
+	{
+		Rc.Left = std::max(Region.Left, 0);
+		Rc.Top = std::max(Region.Top, 0);
+		Rc.Right = std::min(Region.Right, SrcWidth);
+		Rc.Bottom = std::min(Region.Bottom, SrcHeight);
+		if (Rc.Width() <= 0 || Rc.Height() <= 0)
+			return false;
+	}
+
+	if (!Resize(Rc.Width(), Rc.Height()))
+		return false;
+
+	if (!BitBlt(CompatibleDC, 0, 0, Width, Height, WindowDC, Rc.Left, Rc.Top, SRCCOPY))
+		return false;
+
+	GdiFlush(); // GDI may still be writing the DIB section
+	CapturedRegion = Rc;
+	return true;
 }
 
 void BltScreenCapture::Release()
 {
-	if (Bitmap) { DeleteObject(Bitmap); Bitmap = nullptr; }
+	BgrMat.release();
+	if (Bitmap) { SelectObject(CompatibleDC, DefaultBitmap); DeleteObject(Bitmap); Bitmap = nullptr; }
 	if (CompatibleDC) { DeleteDC(CompatibleDC); CompatibleDC = nullptr; }
 	if (WindowDC) { ReleaseDC(Window, WindowDC); WindowDC = nullptr; }
 }
@@ -110,4 +295,11 @@ IScreenCapture* IScreenCapture::CreateInstance()
 	return new Win32::BltScreenCapture();
 }
 
+#else
+
+IScreenCapture* IScreenCapture::CreateInstance()
+{
+	return new ImageScreenCapture({}); // no desktop grab here, feed it with PushImage
+}
+
 #endif // _WIN32
@@ -7,11 +7,14 @@ class IScreenCapture
 {
 public:
 
-	static IScreenCapture* CreateInstance();
+	static IScreenCapture* CreateInstance(); // desktop, images only where there is no desktop backend
+	static IScreenCapture* CreateImageInstance(const std::string& Path = {}); // image file or directory (sorted), then whatever is pushed
 
 	virtual ~IScreenCapture() {}
 	virtual bool Init() = 0;
 	virtual void Release() = 0;
-	virtual bool Capture() = 0;
-	virtual cv::Mat& GetImage() = 0;
+	virtual bool Capture(IntRect Region = {}) = 0; // empty: whole screen, otherwise clipped to screen and only that is copied
+	virtual cv::Mat& GetImage() = 0; // BGRA of captured region, valid until next Capture
+	virtual IntRect GetRegion() const = 0; // what was captured, screen coordinates
+	virtual bool PushImage(const cv::Mat& Image) { return false; } // image backend: next Capture returns it, any thread
 };
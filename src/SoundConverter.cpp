@@ -1,25 +1,187 @@
 #include "SoundConverter.h"
 
 #include <samplerate.h>
+#include <numeric>
+#include <cmath>
+
+// RATIONAL L/M RESAMPLER, ONE DOT PRODUCT PER OUTPUT SAMPLE, NO STATE RESET EVER
+// Prototype lowpass is a Kaiser windowed sinc designed at SrcRate * L, split into L phases of NumTaps each.
+// Taps are stored reversed so every output is a contiguous dot product over the last NumTaps input frames.
+
+class PolyphaseResampler
+{
+public:
+
+	static constexpr uint32_t MaxPhases = 512; // 44100->16000 needs 160
+	static constexpr uint32_t BaseTaps = 16; // per input/output rate ratio
+	static constexpr float Rolloff = 0.92f;
+	static constexpr double KaiserBeta = 7.0; // ~70 dB stopband
+
+	bool Init(uint32_t SrcRate, uint32_t DstRate, uint32_t InNumChannels, size_t MaxBlockFrames);
+	void Reset();
+	size_t Process(const float* Src, size_t NumFrames, float* Dst, size_t MaxDstFrames);
+
+	size_t MaxOutputFrames(size_t NumFrames) const { return (size_t)(((uint64_t)NumFrames * L + M - 1) / M) + 1; }
+	uint32_t GetNumTaps() const { return NumTaps; }
+
+private:
+
+	uint32_t L = 1; // interpolation
+	uint32_t M = 1; // decimation
+	uint32_t NumTaps = 0;
+	uint32_t NumChannels = 1;
+
+	TRawArray<float> Taps; // L x NumTaps, reversed
+	TRawArray<float> History; // (NumTaps - 1 + block) x NumChannels
+	size_t InputPos = 0; // newest frame of next output, relative to History
+	uint32_t Phase = 0;
+};
+
+static double BesselI0(double x)
+{
+	double Sum = 1.0, Term = 1.0;
+	for (int k = 1; k < 32; ++k)
+	{
+		const double f = x / (2.0 * k);
+		Term *= f * f;
+		Sum += Term;
+		if (Term < Sum * 1e-12)
+			break;
+	}
+	return Sum;
+}
+
+bool PolyphaseResampler::Init(uint32_t SrcRate, uint32_t DstRate, uint32_t InNumChannels, size_t MaxBlockFrames)
+{
+	const uint32_t Gcd = std::gcd(SrcRate, DstRate);
+	L = DstRate / Gcd;
+	M = SrcRate / Gcd;
+	NumChannels = InNumChannels;
+
+	if (L > MaxPhases)
+		return false;
+
+	// keep transition band width constant relative to output rate when decimating
+	const uint32_t RatioTaps = BaseTaps * ((std::max(L, M) + L - 1) / L);
+	NumTaps = (RatioTaps + 7) & ~7u;
+
+	const size_t ProtoLen = (size_t)L * NumTaps;
+	const double Cutoff = 0.5 * Rolloff / std::max(L, M); // cycles per upsampled sample
+	const double Center = (ProtoLen - 1) * 0.5;
+	const double InvI0Beta = 1.0 / BesselI0(KaiserBeta);
+	const double Pi = 3.14159265358979323846;
+
+	Taps.resize(ProtoLen);
+	for (uint32_t p = 0; p < L; ++p)
+	{
+		for (uint32_t j = 0; j < NumTaps; ++j)
+		{
+			const size_t n = p + (size_t)j * L;
+			const double t = n - Center;
+			const double x = 2.0 * Cutoff * t;
+			const double Sinc = (fabs(x) < 1e-12) ? 1.0 : sin(Pi * x) / (Pi * x);
+			const double w = 2.0 * t / (ProtoLen - 1);
+			const double Window = BesselI0(KaiserBeta * sqrt(std::max(0.0, 1.0 - w * w))) * InvI0Beta;
+			Taps[(size_t)p * NumTaps + (NumTaps - 1 - j)] = (float)(2.0 * Cutoff * Sinc * Window * L);
+		}
+	}
+
+	History.reserve((NumTaps - 1 + std::max(MaxBlockFrames, (size_t)1)) * NumChannels);
+	Reset();
+
+	logi("Polyphase L={} M={} NumTaps={}", L, M, NumTaps);
+	return true;
+}
+
+void PolyphaseResampler::Reset()
+{
+	History.resize((size_t)(NumTaps - 1) * NumChannels);
+	memset(History.data(), 0, History.size() * sizeof(float));
+	InputPos = NumTaps - 1;
+	Phase = 0;
+}
+
+size_t PolyphaseResampler::Process(const float* Src, size_t NumFrames, float* Dst, size_t MaxDstFrames)
+{
+	History.append(Src, NumFrames * NumChannels);
+	const size_t NumFramesTotal = History.size() / NumChannels;
+
+	float* Out = Dst;
+	const float* In = History.data();
+	size_t NumOut = 0;
+
+	while (InputPos < NumFramesTotal && NumOut < MaxDstFrames)
+	{
+		const float* h = Taps.data() + (size_t)Phase * NumTaps;
+		const size_t First = InputPos + 1 - NumTaps;
+
+		if (NumChannels == 1)
+		{
+			const float* x = In + First;
+			float Acc = 0;
+			for (uint32_t j = 0; j < NumTaps; ++j)
+				Acc += h[j] * x[j];
+			*Out++ = Acc;
+		}
+		else
+		{
+			for (uint32_t c = 0; c < NumChannels; ++c)
+			{
+				const float* x = In + First * NumChannels + c;
+				float Acc = 0;
+				for (uint32_t j = 0; j < NumTaps; ++j)
+					Acc += h[j] * x[(size_t)j * NumChannels];
+				*Out++ = Acc;
+			}
+		}
+		NumOut++;
+
+		Phase += M;
+		InputPos += Phase / L;
+		Phase %= L;
+	}
+
+	// keep last NumTaps - 1 frames for next block
+	const size_t Keep = NumTaps - 1;
+	const size_t Drop = std::min(NumFramesTotal - Keep, InputPos - Keep);
+	memmove(History.data(), History.data() + Drop * NumChannels, (NumFramesTotal - Drop) * NumChannels * sizeof(float));
+	History.resize((NumFramesTotal - Drop) * NumChannels);
+	InputPos -= Drop;
+
+	return NumOut;
+}
+
+// SINGLE PASS: native bytes -> f32 -> mono -> resampled, one L1 sized block at a time, straight into caller memory
 
 class StoneAgeSoundConverter : public ISoundConverter
 {
 public:
 
+	static constexpr size_t BlockFrames = 256;
+
 	virtual ~StoneAgeSoundConverter() override { Release(); }
-	virtual bool Init(const WaveFormat& SrcFormat, const WaveFormat& DstFormat) override;
+	virtual bool Init(const WaveFormat& SrcFormat, const WaveFormat& DstFormat, EResamplerQuality Quality, size_t MaxChunkFrames) override;
 	virtual void Release() override;
+	virtual void Reset() override;
+	virtual size_t GetMaxOutputSize(size_t NumBytes) const override;
+	virtual size_t Process(const uint8_t* InBytes, size_t NumBytes, std::span<float> Dst) override;
 	virtual bool Process(const TRawArray<uint8_t>& InBytes) override;
 	virtual TRawArray<float>& GetOutputBuffer() override { return SamplesBuf; }
 
 private:
 
+	const float* ConvertBlock(const uint8_t* InBytes, size_t NumFrames);
+	size_t ResampleBlock(const float* Src, size_t NumFrames, float* Dst, size_t MaxDstFrames);
+
 	WaveFormat InputFormat {};
 	WaveFormat OutputFormat {};
+	EResamplerQuality ResamplerQuality = EResamplerQuality::Polyphase;
 	SRC_STATE* ResamplerState = nullptr;
+	std::unique_ptr<PolyphaseResampler> Polyphase;
 
+	TRawArray<float> BlockBuf; // BlockFrames x InputChannels
+	TRawArray<float> MonoBuf; // BlockFrames x OutputChannels
 	TRawArray<float> SamplesBuf;
-	TRawArray<float> TmpBuf;
 };
 
 static void PrintFormat(const char* Prefix, const WaveFormat& wf)
@@ -38,17 +200,21 @@ static bool ValidateFormat(const WaveFormat& wf)
 {
 	return 
 		(wf.Format != EWaveFormat::UNSUPPORTED)
-		&& (wf.NumChannels == 1 || wf.NumChannels == 2)
+		&& (wf.NumChannels >= 1 && wf.NumChannels <= 8)
 		&& (wf.SampleRate != 0)
-		&& (wf.BitsPerSample == 16 || wf.BitsPerSample == 32);
+		&& (wf.Format == EWaveFormat::PCM ? (wf.BitsPerSample == 16 || wf.BitsPerSample == 24 || wf.BitsPerSample == 32) : (wf.BitsPerSample == 32));
 }
 
-bool StoneAgeSoundConverter::Init(const WaveFormat& SrcFormat, const WaveFormat& DstFormat)
+bool StoneAgeSoundConverter::Init(const WaveFormat& SrcFormat, const WaveFormat& DstFormat, EResamplerQuality Quality, size_t MaxChunkFrames)
 {
 	do
 	{
 		InputFormat = SrcFormat;
 		OutputFormat = DstFormat;
+		ResamplerQuality = Quality;
+
+		InputFormat.ComputeBlockAlign();
+		OutputFormat.ComputeBlockAlign();
 
 		PrintFormat("InputFormat: ", InputFormat);
 		PrintFormat("OutputFormat: ", OutputFormat);
@@ -71,14 +237,63 @@ bool StoneAgeSoundConverter::Init(const WaveFormat& SrcFormat, const WaveFormat&
 			break;
 		}
 
+		if (OutputFormat.NumChannels != 1 && OutputFormat.NumChannels != InputFormat.NumChannels)
+		{
+			loge("Unsupported NumChannels");
+			break;
+		}
+
+		if (!MaxChunkFrames)
+		{
+			MaxChunkFrames = InputFormat.SampleRate; // 1 sec
+		}
+
+		// preallocate, nothing grows after this unless chunk exceeds MaxChunkFrames
+		BlockBuf.resize(BlockFrames * InputFormat.NumChannels);
+		MonoBuf.resize(BlockFrames * OutputFormat.NumChannels);
+		SamplesBuf.reserve(GetMaxOutputSize(MaxChunkFrames * InputFormat.BlockAlign));
+
+		if (InputFormat.SampleRate == OutputFormat.SampleRate)
+		{
+			return true;
+		}
+
+		if (ResamplerQuality == EResamplerQuality::Polyphase)
+		{
+			Polyphase.reset(new PolyphaseResampler());
+			if (Polyphase->Init(InputFormat.SampleRate, OutputFormat.SampleRate, OutputFormat.NumChannels, BlockFrames))
+			{
+				return true;
+			}
+			logi("Polyphase ratio {}/{} is too odd, fallback to SincFastest", OutputFormat.SampleRate, InputFormat.SampleRate);
+			Polyphase.reset();
+			ResamplerQuality = EResamplerQuality::SincFastest;
+		}
+
+		int ConverterType = SRC_LINEAR;
+		switch (ResamplerQuality)
+		{
+			case EResamplerQuality::SincFastest: ConverterType = SRC_SINC_FASTEST; break;
+			case EResamplerQuality::SincMedium: ConverterType = SRC_SINC_MEDIUM_QUALITY; break;
+			default: break;
+		}
+
 		int Error = 0;
-		ResamplerState = src_new(SRC_LINEAR, DstFormat.NumChannels, &Error);
+		ResamplerState = src_new(ConverterType, OutputFormat.NumChannels, &Error);
 		if (Error != 0)
 		{
 			loge("src_new Error={}", Error);
 			break;
 		}
 
+		const double Ratio = (double)OutputFormat.SampleRate / (double)InputFormat.SampleRate;
+		Error = src_set_ratio(ResamplerState, Ratio);
+		if (Error != 0)
+		{
+			loge("src_set_ratio Error={}", Error);
+			break;
+		}
+
 		return true;
 	}
 	while (0);
@@ -94,94 +309,143 @@ void StoneAgeSoundConverter::Release()
 		src_delete(ResamplerState);
 		ResamplerState = nullptr;
 	}
+
+	Polyphase.reset();
 }
 
-bool StoneAgeSoundConverter::Process(const TRawArray<uint8_t>& InBytes)
+void StoneAgeSoundConverter::Reset()
 {
-	if (!InBytes.size())
-		return false;
-
-	//const size_t NumChunkFrames = InBytes.size() / InputFormat.BlockAlign;
-	//const size_t NumChunkSamples = InBytes.size() / (InputFormat.BitsPerSample / 8);
+	if (ResamplerState)
+	{
+		src_reset(ResamplerState);
+	}
 
-	if (InputFormat.Format == EWaveFormat::FLOAT && InputFormat.BitsPerSample == 32)
+	if (Polyphase)
 	{
-		const TRawArrayView<float> ChunkF32(InBytes);
-		SamplesBuf.copy(ChunkF32.data(), ChunkF32.size());
+		Polyphase->Reset();
 	}
-	else if (InputFormat.Format == EWaveFormat::PCM && InputFormat.BitsPerSample == 16) // not tested
+}
+
+size_t StoneAgeSoundConverter::GetMaxOutputSize(size_t NumBytes) const
+{
+	if (!InputFormat.BlockAlign)
+		return 0;
+
+	const size_t NumFrames = NumBytes / InputFormat.BlockAlign;
+	const size_t NumBlocks = (NumFrames + BlockFrames - 1) / BlockFrames;
+	const size_t NumOutFrames = (size_t)(((uint64_t)NumFrames * OutputFormat.SampleRate + InputFormat.SampleRate - 1) / InputFormat.SampleRate);
+	return (NumOutFrames + NumBlocks + 16) * OutputFormat.NumChannels;
+}
+
+const float* StoneAgeSoundConverter::ConvertBlock(const uint8_t* InBytes, size_t NumFrames)
+{
+	const auto& Kernels = GetWaveKernels();
+	const size_t NumSamples = NumFrames * InputFormat.NumChannels;
+
+	const float* Samples = BlockBuf.data();
+	if (InputFormat.Format == EWaveFormat::FLOAT)
 	{
-		const TRawArrayView<int16_t> ChunkS16(InBytes);
-		SamplesBuf.resize(ChunkS16.size());
-		S16toF32(ChunkS16.data(), ChunkS16.size(), SamplesBuf.data(), SamplesBuf.size());
+		Samples = (const float*)InBytes; // no copy
 	}
 	else
 	{
-		loge("Unsupported InputFormat");
-		return false;
+		switch (InputFormat.BitsPerSample)
+		{
+			case 16: Kernels.S16toF32((const int16_t*)InBytes, BlockBuf.data(), NumSamples); break;
+			case 24: Kernels.S24toF32(InBytes, BlockBuf.data(), NumSamples); break;
+			case 32: Kernels.S32toF32((const int32_t*)InBytes, BlockBuf.data(), NumSamples); break;
+		}
 	}
 
-	#if 1
 	if (InputFormat.NumChannels != OutputFormat.NumChannels)
 	{
-		if (InputFormat.NumChannels == 2 && OutputFormat.NumChannels == 1)
-		{
-			Stereo2Mono(SamplesBuf.data(), SamplesBuf.size(), TmpBuf);
-			TmpBuf.swap(SamplesBuf);
-		}
-		else
-		{
-			loge("Unsupported NumChannels");
-			return false;
-		}
+		Kernels.Downmix(Samples, MonoBuf.data(), NumFrames, InputFormat.NumChannels);
+		Samples = MonoBuf.data();
 	}
-	#endif
 
-	#if 1
-	if (InputFormat.SampleRate != OutputFormat.SampleRate)
+	return Samples;
+}
+
+size_t StoneAgeSoundConverter::ResampleBlock(const float* Src, size_t NumFrames, float* Dst, size_t MaxDstFrames)
+{
+	if (Polyphase)
 	{
-		if (!ResamplerState)
-		{
-			loge("resampler not initialized");
-			return false;
-		}
+		return Polyphase->Process(Src, NumFrames, Dst, MaxDstFrames);
+	}
 
-		int Error = src_reset(ResamplerState);
-		if (Error != 0)
+	if (ResamplerState)
+	{
+		// state carries over from previous block, sinc modes may hold back a few frames
+		// src_process stops early when output is full, keep feeding until all input is used
+		size_t NumGenerated = 0;
+		while (NumFrames)
 		{
-			loge("src_reset Error={}", Error);
-			return false;
-		}
+			SRC_DATA Data {};
+			Data.data_in = Src;
+			Data.input_frames = (long)NumFrames;
+			Data.data_out = Dst + NumGenerated * OutputFormat.NumChannels;
+			Data.output_frames = (long)(MaxDstFrames - NumGenerated);
+			Data.src_ratio = (double)OutputFormat.SampleRate / (double)InputFormat.SampleRate;
+			Data.end_of_input = 0;
 
-		const double Ratio = (double)OutputFormat.SampleRate / (double)InputFormat.SampleRate;
-		const size_t NumSamples = SamplesBuf.size();
-		const size_t NumConvertedSamples = (size_t)(NumSamples * Ratio) + 16;
-		TmpBuf.resize(NumConvertedSamples);
-
-		SRC_DATA Data {};
-		Data.data_in = SamplesBuf.data();
-		Data.input_frames = (long)NumSamples;
-		Data.data_out = TmpBuf.data();
-		Data.output_frames = (long)NumConvertedSamples;
-		Data.src_ratio = Ratio;
-		Data.end_of_input = 0;
-
-		src_set_ratio(ResamplerState, Ratio);
-
-		//logi("Resample {} -> {} Ratio={}", NumSamples, NumConvertedSamples, Ratio);
-		Error = src_process(ResamplerState, &Data);
-		if (Error != 0)
-		{
-			loge("src_process Error={}", Error);
-			return false;
+			const int Error = src_process(ResamplerState, &Data);
+			if (Error != 0)
+			{
+				loge("src_process Error={}", Error);
+				break;
+			}
+
+			Src += Data.input_frames_used * OutputFormat.NumChannels;
+			NumFrames -= (size_t)Data.input_frames_used;
+			NumGenerated += (size_t)Data.output_frames_gen;
+
+			if (!Data.input_frames_used && !Data.output_frames_gen) // no room left
+			{
+				loge("src_process dropped {} input frames, output full", NumFrames);
+				break;
+			}
 		}
+		return NumGenerated;
+	}
+
+	const size_t NumCopy = std::min(NumFrames, MaxDstFrames);
+	if (Src != Dst)
+	{
+		memcpy(Dst, Src, NumCopy * OutputFormat.BlockAlign);
+	}
+	return NumCopy;
+}
 
-		TmpBuf.resize(Data.output_frames_gen);
-		TmpBuf.swap(SamplesBuf);
+size_t StoneAgeSoundConverter::Process(const uint8_t* InBytes, size_t NumBytes, std::span<float> Dst)
+{
+	if (!InputFormat.BlockAlign)
+	{
+		loge("converter not initialized");
+		return 0;
 	}
-	#endif
 
-	return true;
+	const size_t NumFrames = NumBytes / InputFormat.BlockAlign;
+	const size_t MaxDstFrames = Dst.size() / OutputFormat.NumChannels;
+	size_t NumWritten = 0;
+
+	for (size_t Frame = 0; Frame < NumFrames; Frame += BlockFrames)
+	{
+		const size_t NumBlockFrames = std::min(BlockFrames, NumFrames - Frame);
+		const float* Samples = ConvertBlock(InBytes + Frame * InputFormat.BlockAlign, NumBlockFrames);
+		NumWritten += ResampleBlock(Samples, NumBlockFrames, Dst.data() + NumWritten * OutputFormat.NumChannels, MaxDstFrames - NumWritten);
+	}
+
+	return NumWritten * OutputFormat.NumChannels;
+}
+
+bool StoneAgeSoundConverter::Process(const TRawArray<uint8_t>& InBytes)
+{
+	if (!InBytes.size())
+		return false;
+
+	SamplesBuf.resize(GetMaxOutputSize(InBytes.size()));
+	SamplesBuf.resize(Process(InBytes.data(), InBytes.size(), std::span<float>(SamplesBuf.data(), SamplesBuf.size())));
+	return SamplesBuf.size() != 0;
 }
 
 ISoundConverter* ISoundConverter::CreateInstance()
@@ -1,16 +1,36 @@
 #pragma once
 
 #include "WaveCore.h"
+#include <span>
+
+// latency/quality profiles, cheapest first except Polyphase
+enum class EResamplerQuality
+{
+	Linear, // libsamplerate SRC_LINEAR, no delay, aliasing
+	SincFastest, // libsamplerate SRC_SINC_FASTEST
+	SincMedium, // libsamplerate SRC_SINC_MEDIUM_QUALITY
+	Polyphase, // built-in fixed ratio FIR with precomputed taps (48k->16k etc), falls back to SincFastest for odd ratios
+};
 
 class ISoundConverter
 {
 public:
 
+	static constexpr const char* QualityNames[] = {"Linear", "SincFastest", "SincMedium", "Polyphase"};
 	static ISoundConverter* CreateInstance();
 
 	virtual ~ISoundConverter() {}
-	virtual bool Init(const WaveFormat& SrcFormat, const WaveFormat& DstFormat) = 0;
+
+	// resampler state is kept between Process calls, MaxChunkFrames only sizes buffers upfront
+	virtual bool Init(const WaveFormat& SrcFormat, const WaveFormat& DstFormat, EResamplerQuality Quality = EResamplerQuality::Polyphase, size_t MaxChunkFrames = 0) = 0;
 	virtual void Release() = 0;
+	virtual void Reset() = 0; // drop filter history, next chunk starts a new stream
+	virtual size_t GetMaxOutputSize(size_t NumBytes) const = 0; // upper bound of samples produced from NumBytes of input
+
+	// fused convert, downmix, resample straight into Dst, returns number of samples written
+	virtual size_t Process(const uint8_t* InBytes, size_t NumBytes, std::span<float> Dst) = 0;
+
+	// same thing into GetOutputBuffer
 	virtual bool Process(const TRawArray<uint8_t>& InBytes) = 0;
 	virtual TRawArray<float>& GetOutputBuffer() = 0;
 };
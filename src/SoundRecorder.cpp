@@ -264,3 +264,133 @@ ISoundRecorder* ISoundRecorder::CreateInstance()
 }
 
 #endif // _WIN32
+
+// FILE REPLAY, SAME BYTES A DEVICE WOULD GIVE US, NO DEVICE REQUIRED
+
+#include "MappedFile.h"
+#include <chrono>
+
+class FileSoundRecorder : public ISoundRecorder
+{
+public:
+
+	FileSoundRecorder(const FileParams& InParams) : Params(InParams) {}
+	virtual ~FileSoundRecorder() override { Release(); }
+	virtual bool Init(WaveFormat& OutDeviceFormat) override;
+	virtual void Release() override;
+	virtual void Flush() override;
+	virtual PollResult Poll(TRawArray<uint8_t>& DstBuffer) override;
+	virtual bool IsFinished() const override { return Finished; }
+
+private:
+
+	FileParams Params;
+	std::shared_ptr<MappedFile> File;
+	WaveFormat FileFormat {};
+	size_t DataOffset = 0;
+	uint64_t NumDataFrames = 0;
+	uint64_t NumTailFrames = 0;
+	uint64_t FramePos = 0; // data frames, then tail silence frames
+	std::chrono::high_resolution_clock::time_point StartTimestamp {};
+	bool Finished = false;
+};
+
+bool FileSoundRecorder::Init(WaveFormat& OutDeviceFormat)
+{
+	do
+	{
+		File = MappedFile::Open(Params.Filename);
+		GUARD_BREAK(File, "Failed to open wave file");
+
+		size_t DataSize = 0;
+		GUARD_BREAK(ParseWave(File->data(), File->size(), FileFormat, DataOffset, DataSize), "Unsupported wave file");
+
+		NumDataFrames = DataSize / FileFormat.BlockAlign;
+		NumTailFrames = (uint64_t)(std::max(Params.TailSilenceDuration, 0.0f) * FileFormat.SampleRate);
+		Params.ChunkFrames = std::max(Params.ChunkFrames, 1u);
+
+		logi("FileRecorder {} Chan={} Rate={} Bits={} Duration={:.1f}s Speed={}", Params.Filename, 
+			FileFormat.NumChannels, FileFormat.SampleRate, FileFormat.BitsPerSample, NumDataFrames / (double)FileFormat.SampleRate, Params.Speed);
+
+		OutDeviceFormat = FileFormat;
+		Flush();
+		return true;
+	}
+	while (0);
+
+	Release();
+	return false;
+}
+
+void FileSoundRecorder::Release()
+{
+	File.reset();
+}
+
+void FileSoundRecorder::Flush()
+{
+	FramePos = 0;
+	Finished = false;
+	StartTimestamp = std::chrono::high_resolution_clock::now();
+}
+
+ISoundRecorder::PollResult FileSoundRecorder::Poll(TRawArray<uint8_t>& DstBuffer)
+{
+	ISoundRecorder::PollResult Res {};
+
+	if (!File || Finished)
+		return Res;
+
+	const uint64_t NumTotalFrames = NumDataFrames + NumTailFrames;
+	if (FramePos >= NumTotalFrames)
+	{
+		if (!Params.Loop)
+		{
+			Finished = true;
+			return Res;
+		}
+		FramePos = 0;
+		StartTimestamp = std::chrono::high_resolution_clock::now();
+	}
+
+	uint64_t NumFrames = std::min<uint64_t>(Params.ChunkFrames, NumTotalFrames - FramePos);
+	if (Params.Speed > 0.0f) // pace like a device, deliver only what has been "recorded" so far
+	{
+		const double Elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - StartTimestamp).count();
+		const uint64_t AvailFrames = (uint64_t)(Elapsed * Params.Speed * FileFormat.SampleRate);
+		if (AvailFrames < FramePos + NumFrames)
+			return Res;
+	}
+
+	DstBuffer.resize((size_t)NumFrames * FileFormat.BlockAlign);
+
+	const uint64_t NumCopy = (FramePos < NumDataFrames ? std::min(NumFrames, NumDataFrames - FramePos) : 0);
+	if (NumCopy)
+	{
+		memcpy(DstBuffer.data(), File->data() + DataOffset + FramePos * FileFormat.BlockAlign, (size_t)NumCopy * FileFormat.BlockAlign);
+	}
+	if (NumCopy < NumFrames)
+	{
+		memset(DstBuffer.data() + NumCopy * FileFormat.BlockAlign, 0, (size_t)(NumFrames - NumCopy) * FileFormat.BlockAlign);
+		Res.Silent = !NumCopy;
+	}
+
+	FramePos += NumFrames;
+	Res.DataSize = DstBuffer.size();
+	return Res;
+}
+
+ISoundRecorder* ISoundRecorder::CreateFileInstance(const FileParams& Params)
+{
+	return new FileSoundRecorder(Params);
+}
+
+#if !defined(_WIN32)
+
+ISoundRecorder* ISoundRecorder::CreateInstance()
+{
+	loge("No capture backend on this platform, use file recorder");
+	return nullptr;
+}
+
+#endif
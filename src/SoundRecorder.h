@@ -6,7 +6,18 @@ class ISoundRecorder
 {
 public:
 
-	static ISoundRecorder* CreateInstance();
+	static ISoundRecorder* CreateInstance(); // default capture device
+
+	// replays WAV file (any rate, PCM16/24/32 or F32, any channels), Speed 1 is real time, 0 is as fast as consumer polls
+	struct FileParams
+	{
+		std::string Filename;
+		float Speed = 1.0f;
+		uint32_t ChunkFrames = 480; // 10 ms at 48k, roughly what WASAPI hands out
+		float TailSilenceDuration = 2.0f; // lets silence based segmentation flush last words
+		bool Loop = false;
+	};
+	static ISoundRecorder* CreateFileInstance(const FileParams& Params);
 
 	virtual ~ISoundRecorder() {}
 	virtual bool Init(WaveFormat& OutDeviceFormat) = 0;
@@ -15,4 +26,5 @@ public:
 
 	struct PollResult { size_t ErrorCode; size_t DataSize; bool Silent; };
 	virtual PollResult Poll(TRawArray<uint8_t>& DstBuffer) = 0;
+	virtual bool IsFinished() const { return false; } // file replay reached the end
 };
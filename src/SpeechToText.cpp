@@ -1,6 +1,9 @@
 #include "SpeechToText.h"
 #include "SoundRecorder.h"
 #include "SoundConverter.h"
+#include "RingBuffer.h"
+#include "VoiceDetector.h"
+#include "MappedFile.h"
 
 #include <BS_thread_pool.hpp>
 #include <samplerate.h>
@@ -10,52 +13,193 @@
 #include <iostream>
 #include <fstream>
 #include <filesystem>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <thread>
+
+// loaded model plus its decoder states, jobs hold a reference so model can be swapped under them
+struct WhisperEngine
+{
+	std::string ModelPath;
+	bool UseGpu = false;
+	int NumStates = 0;
+	uint32_t Generation = 0;
+
+	whisper_context* Context = nullptr;
+	std::vector<whisper_state*> States;
+	std::vector<whisper_state*> FreeStates;
+	std::mutex StateMutex;
+
+	~WhisperEngine()
+	{
+		for (auto* State : States)
+		{
+			whisper_free_state(State);
+		}
+		if (Context)
+		{
+			whisper_free(Context);
+		}
+	}
+
+	bool Matches(const std::string& Path, bool Gpu, int Num) const { return ModelPath == Path && UseGpu == Gpu && NumStates == Num; }
+
+	whisper_state* AcquireState()
+	{
+		std::lock_guard<std::mutex> Lock(StateMutex);
+		if (FreeStates.empty())
+		{
+			loge("No free whisper state");
+			return nullptr;
+		}
+		whisper_state* State = FreeStates.back();
+		FreeStates.pop_back();
+		return State;
+	}
+
+	void ReleaseState(whisper_state* State)
+	{
+		std::lock_guard<std::mutex> Lock(StateMutex);
+		FreeStates.push_back(State);
+	}
+};
 
 class WhisperSpeechToText : public ISpeechToText
 {
 public:
 
-	virtual ~WhisperSpeechToText() override { Release(); }
+	WhisperSpeechToText();
+	virtual ~WhisperSpeechToText() override { Release(); StandbyEngine.reset(); }
 	virtual void Serialize(IniFile& Config, bool Save) override;
 	virtual bool Init(ResultCallback Callback) override;
 	virtual void Release() override;
 	virtual void RenderUI() override;
+	virtual bool IsDrained() const override { return ReplayDone && NextDeliverSeq == NextSeq; }
+	virtual uint64_t GetNumDroppedSegments() const override { return NumDroppedSegments; }
+	virtual EModelStatus GetModelStatus() const override;
 
 private:
 
 	void PollRecorder();
-	void WhisperProcess(const TRawArray<float>& InSamples);
+	void PollSegments(uint64_t WritePos);
+	void PollStream(uint64_t WritePos);
+	void ReleaseSamples(uint64_t EndPos);
+	void SubmitSegment(uint64_t StartPos, uint64_t EndPos);
+	std::chrono::high_resolution_clock::time_point GetCaptureTime(uint64_t Pos) const;
+	void RunPendingSegment();
+	void Deliver(uint64_t Seq, uint64_t ConsumePos, Result* Res);
+	std::string ResolveModelPath(const std::string& Name) const;
+	bool LoadModel(const std::string& Name);
+	std::shared_ptr<WhisperEngine> CreateEngine(const std::string& Path, int NumStates);
+	void SwapEngine(std::shared_ptr<WhisperEngine> NewEngine);
+	std::shared_ptr<WhisperEngine> WaitEngine();
+	void WhisperProcess(WhisperEngine& Eng, whisper_state* State, uint64_t SamplePos, size_t NumSamples, Result& Res);
+	void StreamProcess(uint64_t Seq, uint64_t StartPos, uint64_t EndPos, bool Final, std::chrono::high_resolution_clock::time_point CaptureTime);
 
 	ResultCallback ResCallback;
 
-	float SampleLevelThreshold = 0.005f;
 	float SplitSilenceDuration = 0.05f;
 	float FlushSilenceDuration = 10.0f;
 	float MinSegmentDuration = 2.0f;
 	float MaxSegmentDuration = 10.0f;
+	float SampleBufferDuration = 60.0f;
+
+	static constexpr float MaxSegmentDurationLimit = 30.0f;
+
+	// streaming: re-decode sliding window every step, commit segments that survived two decodes
+	bool StreamMode = false;
+	float StreamStepDuration = 1.0f;
+	float StreamContextDuration = 10.0f;
+	float StreamPrerollDuration = 0.3f;
+	int StreamPromptTokens = 128;
 
 	std::string WhisperModel = "ggml-small.bin";
-	int NumProcessors = 1;
-	int NumThreads = 8;
+	int NumProcessors = 1; // whisper states decoding segments in parallel
+	int NumThreads = 8; // total budget, split between states
 	bool UseGpu = false;
 
+	// backpressure when all states are busy and segments keep coming
+	enum EDropPolicy { DropPolicyQueue, DropPolicyOldest, DropPolicyNewest };
+	static constexpr const char* DropPolicyNames[] = {"Queue", "DropOldest", "DropNewest"};
+	std::string DropPolicy = "DropOldest";
+	int DropPolicyId = DropPolicyOldest;
+	int MaxPendingSegments = 2;
+
 	WaveFormat DeviceFormat {};
 	WaveFormat WhisperFormat {};
 
 	std::unique_ptr<ISoundRecorder> Recorder;
+	std::string RecorderFile; // replay WAV instead of capture device, headless runs and benchmarks
+	float RecorderFileSpeed = 1.0f; // 0 = as fast as decoder keeps up, lossless (waits for ring space and pending segments)
+	int RecorderFileChunk = 480;
+	bool RecorderFileLoop = false;
+	bool ReplayStarted = false; // RecorderThread, file replay waits for the model
+	size_t MaxPollBytes = 0;
 	std::unique_ptr<ISoundConverter> Converter;
+	std::string ResamplerQuality = "Polyphase";
+
+	static constexpr size_t NumVoiceDetectors = std::size(IVoiceDetector::Names);
+	std::string VoiceDetector = "Spectral";
+	std::unique_ptr<IVoiceDetector> VoiceDetectors[NumVoiceDetectors];
+	std::atomic<int> VoiceDetectorId; // selected by GUI
+	int ActiveVoiceDetectorId = -1; // used by RecorderThread
 
 	whisper_context_params WhisperContextParams {};
 	whisper_full_params WhisperFullParams {};
-	whisper_context* WhisperContext {};
+	int NumThreadsPerState = 1;
+
+	// model loads in background while audio keeps buffering, previous model stays warm for instant switch back
+	bool KeepStandbyModel = true;
+	std::shared_ptr<WhisperEngine> Engine;
+	std::shared_ptr<WhisperEngine> StandbyEngine;
+	std::mutex EngineMutex;
+	std::condition_variable EngineCond;
+	std::unique_ptr<std::thread> LoaderThread;
+	std::atomic<int> Loading;
+	std::atomic<int> LoadFailed; // last load failed, WaitEngine stops waiting
+	std::string LoadError; // EngineMutex
+	uint32_t NextGeneration = 1;
+	char ModelInput[512] = {0}; // GUI
+
+	// segments waiting for a free state (RecorderThread -> WhisperThreadPool)
+	struct SegmentJob { uint64_t Seq; uint64_t StartPos; uint64_t EndPos; std::chrono::high_resolution_clock::time_point CaptureTime; };
+	std::deque<SegmentJob> PendingSegments;
+	std::mutex PendingMutex;
+	std::atomic<uint64_t> NumDroppedSegments;
 
-	std::chrono::high_resolution_clock::time_point LastSampleTimestamp {};
-	std::chrono::high_resolution_clock::time_point LastProcessTimestamp {};
+	// results are delivered and samples consumed strictly in submit order
+	struct DoneJob { uint64_t ConsumePos = 0; bool HasResult = false; Result Res; };
+	std::map<uint64_t, DoneJob> DoneJobs;
+	std::mutex DeliverMutex;
+	std::atomic<uint64_t> NextDeliverSeq;
+	std::atomic<uint64_t> NextSeq; // RecorderThread
+	std::atomic<int> ReplayDone; // RecorderThread, file replay ended and flushed
+
+	// sample positions instead of wall clock, file replay at any speed segments exactly like real time
+	uint64_t LastSpeechPos = 0;
+	uint64_t LastProcessPos = 0;
+	std::chrono::high_resolution_clock::time_point LastDataTime {}; // recorder delivered LastDataPos, loopback sends nothing while nothing plays
+	uint64_t LastDataPos = 0;
 
 	TRawArray<uint8_t> ChunkBytes;
-	TRawArray<float> SampleAccumulator;
+	TRingBuffer<float> SampleBuffer; // RecorderThread -> WhisperThreadPool, consumed under DeliverMutex
+	uint64_t SegmentStartPos = 0;
+	uint64_t LastOverflow = 0;
 	TRawArray<float> DebugWavBuffer;
 
+	// stream state (RecorderThread)
+	uint64_t LastStreamPos = 0;
+	bool StreamActive = false;
+	std::atomic<int> StreamPending;
+
+	// stream state (WhisperThreadPool)
+	uint64_t StreamStartPos = 0;
+	std::vector<std::string> StreamSegments;
+	std::vector<whisper_token> StreamTokens;
+	uint32_t StreamGeneration = 0; // tokens belong to this model
+
 	float SegmentDuration = 0;
 	float SilenceDuration = 0;
 	bool Silent = false;
@@ -66,6 +210,21 @@ private:
 	std::unique_ptr<std::thread> RecorderThread;
 };
 
+WhisperSpeechToText::WhisperSpeechToText()
+{
+	// allocate before config
+	for (size_t i = 0; i < NumVoiceDetectors; ++i)
+	{
+		VoiceDetectors[i].reset(IVoiceDetector::CreateInstance(IVoiceDetector::Names[i]));
+	}
+	VoiceDetectorId = 0;
+	Loading = 0;
+	LoadFailed = 0;
+	NextDeliverSeq = 0;
+	NextSeq = 0;
+	ReplayDone = 0;
+}
+
 bool WhisperSpeechToText::Init(ResultCallback Callback)
 {
 	do
@@ -73,8 +232,22 @@ bool WhisperSpeechToText::Init(ResultCallback Callback)
 		ResCallback = std::move(Callback);
 
 		DeviceFormat = {};
-		Recorder.reset(ISoundRecorder::CreateInstance());
-		GUARD_BREAK(Recorder->Init(DeviceFormat), "Failed to init sound recorder");
+		if (RecorderFile.empty())
+		{
+			Recorder.reset(ISoundRecorder::CreateInstance());
+		}
+		else
+		{
+			ISoundRecorder::FileParams Params;
+			Params.Filename = RecorderFile;
+			Params.Speed = RecorderFileSpeed;
+			Params.ChunkFrames = (uint32_t)std::max(RecorderFileChunk, 1);
+			Params.TailSilenceDuration = std::max(FlushSilenceDuration, MinSegmentDuration) + 1.0f;
+			Params.Loop = RecorderFileLoop;
+			Recorder.reset(ISoundRecorder::CreateFileInstance(Params));
+		}
+		GUARD_BREAK(Recorder && Recorder->Init(DeviceFormat), "Failed to init sound recorder");
+		MaxPollBytes = DeviceFormat.SampleRate * DeviceFormat.BlockAlign / 10; // 100 ms per poll tops
 		WhisperFormat = DeviceFormat;
 
 		WhisperFormat.Format = EWaveFormat::FLOAT;
@@ -82,49 +255,88 @@ bool WhisperSpeechToText::Init(ResultCallback Callback)
 		WhisperFormat.SampleRate = WHISPER_SAMPLE_RATE;
 		WhisperFormat.ComputeBlockAlign();
 
-		Converter.reset(ISoundConverter::CreateInstance());
-		GUARD_BREAK(Converter->Init(DeviceFormat, WhisperFormat), "Failed to init sound converter");
+		auto Quality = EResamplerQuality::Polyphase;
+		for (size_t i = 0; i < std::size(ISoundConverter::QualityNames); ++i)
+		{
+			if (ResamplerQuality == ISoundConverter::QualityNames[i])
+				Quality = (EResamplerQuality)i;
+		}
 
-		LastSampleTimestamp = std::chrono::high_resolution_clock::now();
-		LastProcessTimestamp = std::chrono::high_resolution_clock::now();
+		Converter.reset(ISoundConverter::CreateInstance());
+		GUARD_BREAK(Converter->Init(DeviceFormat, WhisperFormat, Quality), "Failed to init sound converter");
 
-		std::filesystem::path FullModelPath(WhisperModel);
-		if (!std::filesystem::exists(FullModelPath))
+		int SelectedDetector = 0; // Level is always available
+		for (size_t i = 0; i < NumVoiceDetectors; ++i)
 		{
-			char ExePath[MAX_PATH] = {0};
-			GetModuleFileNameA(NULL, ExePath, MAX_PATH); // std::filesystem IS SO GOOD
-			auto ExeDir(std::filesystem::path(ExePath).parent_path());
-
-			FullModelPath = ExeDir / WhisperModel;
-			if (!std::filesystem::exists(FullModelPath))
+			if (VoiceDetectors[i] && !VoiceDetectors[i]->Init(WhisperFormat.SampleRate))
 			{
-				FullModelPath = (ExeDir / "models" / WhisperModel);
-				if (!std::filesystem::exists(FullModelPath))
-				{
-					//ModelPath = getenv("WHISPER_MODEL");
-					loge("File not found: {}", FullModelPath.string().c_str());
-					break;
-				}
+				loge("Failed to init voice detector {}", IVoiceDetector::Names[i]);
+				VoiceDetectors[i].reset();
+			}
+			if (VoiceDetectors[i] && VoiceDetector == IVoiceDetector::Names[i])
+			{
+				SelectedDetector = (int)i;
 			}
 		}
+		GUARD_BREAK(VoiceDetectors[0], "No voice detector");
+		VoiceDetector = IVoiceDetector::Names[SelectedDetector];
+		VoiceDetectorId = SelectedDetector;
+		ActiveVoiceDetectorId = -1;
+
+		LastSpeechPos = 0;
+		LastProcessPos = 0;
+		LastDataTime = std::chrono::high_resolution_clock::now();
+		LastDataPos = 0;
 
 		//whisper_log_set(&WhisperLogCallback, nullptr);
 
 		WhisperContextParams = whisper_context_default_params();
 		WhisperContextParams.use_gpu = UseGpu;
 
-		WhisperFullParams = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
-		WhisperFullParams.n_threads = NumThreads;
+		const int NumStates = std::clamp(NumProcessors, 1, 8);
+		NumThreadsPerState = std::max(1, NumThreads / NumStates);
 
-		WhisperContext = whisper_init_from_file_with_params(FullModelPath.string().c_str(), WhisperContextParams);
-		GUARD_BREAK(WhisperContext, "whisper_init");
+		WhisperFullParams = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
+		WhisperFullParams.n_threads = NumThreadsPerState;
 
+		// returns right away, segments wait in SampleBuffer until model is ready
 		ExitFlag = 0;
-		WhisperThreadPool.reset(new BS::thread_pool(1)); // don't change
+		GUARD_BREAK(LoadModel(WhisperModel), "Failed to load whisper model");
+
+		DropPolicyId = DropPolicyOldest;
+		for (int i = 0; i < (int)std::size(DropPolicyNames); ++i)
+		{
+			if (DropPolicy == DropPolicyNames[i])
+				DropPolicyId = i;
+		}
+
+		PendingSegments.clear();
+		NumDroppedSegments = 0;
+		DoneJobs.clear();
+		NextDeliverSeq = 0;
+		NextSeq = 0;
+		ReplayDone = 0;
+		ReplayStarted = false;
+
+		// enough to hold the longest segment plus a backlog while decoder is busy
+		const size_t MaxSegmentSamples = (size_t)((MaxSegmentDurationLimit + 1.0f) * WhisperFormat.SampleRate);
+		const size_t BufferSamples = (size_t)(std::max(SampleBufferDuration, MaxSegmentDurationLimit * 2.0f) * WhisperFormat.SampleRate);
+		GUARD_BREAK(SampleBuffer.init(BufferSamples, MaxSegmentSamples), "SampleBuffer.init");
+		SegmentStartPos = 0;
+		LastOverflow = 0;
+
+		LastStreamPos = 0;
+		StreamActive = false;
+		StreamPending = 0;
+		StreamStartPos = 0;
+		StreamSegments.clear();
+		StreamTokens.clear();
+
+		WhisperThreadPool.reset(new BS::thread_pool(NumStates)); // one thread per state, AcquireState never waits
 
 		RecorderThread.reset(new std::thread([this]()
 		{
-			while (!ExitFlag) { PollRecorder(); Sleep(1); } // we have cores to spin, samurai
+			while (!ExitFlag) { PollRecorder(); std::this_thread::sleep_for(std::chrono::milliseconds(1)); } // we have cores to spin, samurai
 		}));
 
 		return true;
@@ -148,22 +360,44 @@ void WhisperSpeechToText::Release()
 		RecorderThread.reset();
 	}
 
+	{
+		std::lock_guard<std::mutex> Lock(EngineMutex); // no lost wakeup
+		EngineCond.notify_all(); // wake workers waiting for model
+	}
+
 	if (WhisperThreadPool)
 	{
 		WhisperThreadPool->purge();
 		WhisperThreadPool.reset();
 	}
 
-	if (WhisperContext)
+	if (LoaderThread)
 	{
-		whisper_free(WhisperContext);
-		WhisperContext = nullptr;
+		LoaderThread->join(); // model reader bails out on ExitFlag
+		LoaderThread.reset();
+	}
+
+	SampleBuffer.dealloc();
+	PendingSegments.clear();
+	DoneJobs.clear();
+
+	{
+		std::lock_guard<std::mutex> Lock(EngineMutex);
+		if (Engine && KeepStandbyModel)
+			StandbyEngine = std::move(Engine); // next Init with same model is instant
+		Engine.reset();
 	}
 	whisper_log_set(nullptr, nullptr);
 
 	Recorder.reset();
 	Converter.reset();
 
+	for (auto& Detector : VoiceDetectors)
+	{
+		if (Detector)
+			Detector->Release();
+	}
+
 	if (DebugWavBuffer.size())
 	{
 		SaveWave("debug.wav", WhisperFormat, DebugWavBuffer);
@@ -171,39 +405,233 @@ void WhisperSpeechToText::Release()
 	}
 }
 
+std::string WhisperSpeechToText::ResolveModelPath(const std::string& Name) const
+{
+	std::filesystem::path FullModelPath(Name);
+	if (!std::filesystem::exists(FullModelPath))
+	{
+		#if defined(_WIN32)
+		char ExePath[MAX_PATH] = {0};
+		GetModuleFileNameA(NULL, ExePath, MAX_PATH); // std::filesystem IS SO GOOD
+		auto ExeDir(std::filesystem::path(ExePath).parent_path());
+		#else
+		std::error_code Ec;
+		auto ExeDir(std::filesystem::read_symlink("/proc/self/exe", Ec).parent_path());
+		#endif
+
+		FullModelPath = ExeDir / Name;
+		if (!std::filesystem::exists(FullModelPath))
+		{
+			FullModelPath = (ExeDir / "models" / Name);
+			if (!std::filesystem::exists(FullModelPath))
+			{
+				//ModelPath = getenv("WHISPER_MODEL");
+				loge("File not found: {}", FullModelPath.string().c_str());
+				return {};
+			}
+		}
+	}
+	return FullModelPath.string();
+}
+
+bool WhisperSpeechToText::LoadModel(const std::string& Name)
+{
+	const std::string Path = ResolveModelPath(Name);
+	if (Path.empty())
+		return false;
+
+	const int NumStates = std::clamp(NumProcessors, 1, 8);
+	{
+		std::lock_guard<std::mutex> Lock(EngineMutex);
+		if (Engine && Engine->Matches(Path, UseGpu, NumStates))
+			return true;
+		if (StandbyEngine && StandbyEngine->Matches(Path, UseGpu, NumStates))
+		{
+			logi("Whisper model {} from standby", Path);
+			std::swap(Engine, StandbyEngine);
+			EngineCond.notify_all();
+			return true;
+		}
+	}
+
+	if (LoaderThread)
+	{
+		LoaderThread->join();
+		LoaderThread.reset();
+	}
+
+	{
+		std::lock_guard<std::mutex> Lock(EngineMutex);
+		LoadFailed = 0; // workers wait for this one
+		LoadError.clear();
+	}
+
+	Loading = 1;
+	LoaderThread.reset(new std::thread([this, Path, NumStates]()
+	{
+		const auto Clock0 = std::chrono::high_resolution_clock::now();
+		auto NewEngine = CreateEngine(Path, NumStates);
+		const auto Clock1 = std::chrono::high_resolution_clock::now();
+
+		if (NewEngine)
+		{
+			logi("Whisper model {} loaded in {} ms", Path, std::chrono::duration_cast<std::chrono::milliseconds>(Clock1 - Clock0).count());
+			SwapEngine(std::move(NewEngine));
+		}
+		else if (!ExitFlag)
+		{
+			loge("Whisper model {} failed to load", Path);
+			std::lock_guard<std::mutex> Lock(EngineMutex);
+			LoadError = "Failed to load " + Path;
+			LoadFailed = 1;
+			EngineCond.notify_all(); // waiting segments give up
+		}
+		Loading = 0;
+	}));
+
+	return true;
+}
+
+std::shared_ptr<WhisperEngine> WhisperSpeechToText::CreateEngine(const std::string& Path, int NumStates)
+{
+	auto NewEngine = std::make_shared<WhisperEngine>();
+	NewEngine->ModelPath = Path;
+	NewEngine->UseGpu = WhisperContextParams.use_gpu;
+	NewEngine->NumStates = NumStates;
+
+	auto ModelFile = MappedFile::Open(Path);
+	if (!ModelFile)
+		return {};
+
+	// whisper copies tensors into its own buffers, mapping only saves read calls and page cache hit on reload, released right after
+	MappedFileReader Reader { std::move(ModelFile), 0, &ExitFlag };
+	whisper_model_loader Loader {};
+	Loader.context = &Reader;
+	Loader.read = [](void* Ctx, void* Output, size_t ReadSize) { return ((MappedFileReader*)Ctx)->Read(Output, ReadSize); };
+	Loader.eof = [](void* Ctx) { return ((MappedFileReader*)Ctx)->Eof(); };
+	Loader.close = [](void* Ctx) {};
+
+	NewEngine->Context = whisper_init_with_params_no_state(&Loader, WhisperContextParams);
+	Reader.File.reset();
+	if (!NewEngine->Context)
+	{
+		loge("whisper_init {}", Path);
+		return {};
+	}
+
+	for (int i = 0; i < NumStates; ++i)
+	{
+		whisper_state* State = whisper_init_state(NewEngine->Context);
+		if (!State)
+		{
+			loge("whisper_init_state failed at {}", i);
+			break;
+		}
+		NewEngine->States.push_back(State);
+	}
+	if (NewEngine->States.empty())
+		return {};
+
+	NewEngine->FreeStates = NewEngine->States;
+	logi("Whisper states={} threads={}", NewEngine->States.size(), NumThreadsPerState);
+	return NewEngine;
+}
+
+void WhisperSpeechToText::SwapEngine(std::shared_ptr<WhisperEngine> NewEngine)
+{
+	std::lock_guard<std::mutex> Lock(EngineMutex);
+	NewEngine->Generation = NextGeneration++;
+	if (KeepStandbyModel)
+		StandbyEngine = std::move(Engine); // in flight jobs finish on old model
+	Engine = std::move(NewEngine);
+	EngineCond.notify_all();
+}
+
+std::shared_ptr<WhisperEngine> WhisperSpeechToText::WaitEngine()
+{
+	std::unique_lock<std::mutex> Lock(EngineMutex);
+	EngineCond.wait(Lock, [this]() { return Engine || ExitFlag || LoadFailed; });
+	return ExitFlag ? nullptr : Engine; // null when load failed and there is no previous model
+}
+
+ISpeechToText::EModelStatus WhisperSpeechToText::GetModelStatus() const
+{
+	if (Loading)
+		return EModelStatus::Loading;
+	return (LoadFailed ? EModelStatus::Failed : EModelStatus::Ready);
+}
+
 void WhisperSpeechToText::PollRecorder()
 {
+	const int DetectorId = VoiceDetectorId.load();
+	IVoiceDetector* Detector = VoiceDetectors[DetectorId].get();
+	if (DetectorId != ActiveVoiceDetectorId)
+	{
+		Detector->Reset();
+		ActiveVoiceDetectorId = DetectorId;
+	}
+
+	// file replay starts with the model, load time is not decoder latency and nothing could be decoded before
+	if (!RecorderFile.empty() && !ReplayStarted)
+	{
+		if (GetModelStatus() != EModelStatus::Ready)
+			return;
+		Recorder->Flush(); // pacing clock starts now
+		LastDataTime = std::chrono::high_resolution_clock::now();
+		ReplayStarted = true;
+	}
+
+	// fast replay waits for decoder instead of dropping, device capture can't wait
+	const bool FastReplay = (!RecorderFile.empty() && RecorderFileSpeed <= 0.0f);
+	if (FastReplay && DropPolicyId != DropPolicyQueue)
+	{
+		// at most one segment is submitted per poll, below the limit it is never dropped
+		std::lock_guard<std::mutex> Lock(PendingMutex);
+		if (PendingSegments.size() >= (size_t)std::max(MaxPendingSegments, 1))
+			return;
+	}
+
 	size_t RecordedBytes = 0;
-	for (;;)
+	while (RecordedBytes < MaxPollBytes) // fast replay would otherwise push whole file in one go
 	{
+		if (FastReplay && SampleBuffer.cap() - SampleBuffer.size() < Converter->GetMaxOutputSize(MaxPollBytes))
+		{
+			break;
+		}
+
 		const auto Result = Recorder->Poll(ChunkBytes);
 		if (!Result.DataSize)
 		{
 			break;
 		}
 
-		if (Converter->Process(ChunkBytes))
+		// convert straight into ring, fallback buffer only keeps detector alive when ring is full
+		const size_t MaxSamples = Converter->GetMaxOutputSize(ChunkBytes.size());
+		float* Converted = SampleBuffer.begin_write(MaxSamples);
+		size_t NumConverted = 0;
+		if (Converted)
 		{
-			const auto& ConvertedBuffer = Converter->GetOutputBuffer();
-			SampleAccumulator.append(ConvertedBuffer);
+			NumConverted = Converter->Process(ChunkBytes.data(), ChunkBytes.size(), std::span<float>(Converted, MaxSamples));
+			SampleBuffer.end_write(NumConverted);
+		}
+		else if (Converter->Process(ChunkBytes))
+		{
+			Converted = Converter->GetOutputBuffer().data();
+			NumConverted = Converter->GetOutputBuffer().size();
+			SampleBuffer.drop(NumConverted);
+		}
 
+		if (NumConverted)
+		{
 			#if 0
-			DebugWavBuffer.append(ConvertedBuffer);
+			DebugWavBuffer.append(Converted, NumConverted);
 			#endif
 
-			Silent = true;
-			for (size_t i = 0; i < ConvertedBuffer.size(); ++i)
-			{
-				if (fabsf(ConvertedBuffer[i]) > SampleLevelThreshold)
-				{
-					Silent = false;
-					break;
-				}
-			}
+			Silent = !Detector->Process(Converted, NumConverted);
 
 			if (!Silent)
 			{
-				LastSampleTimestamp = std::chrono::high_resolution_clock::now();
+				LastSpeechPos = SampleBuffer.write_pos();
 			}
 		}
 
@@ -211,79 +639,416 @@ void WhisperSpeechToText::PollRecorder()
 		ChunkBytes.resize(0);
 	}
 
+	const uint64_t Overflow = SampleBuffer.overflow();
+	if (Overflow != LastOverflow)
+	{
+		loge("SampleBuffer overflow, decoder falls behind (dropped {} samples)", Overflow - LastOverflow);
+		LastOverflow = Overflow;
+	}
+
+	const uint64_t WritePos = SampleBuffer.write_pos();
+
 	const auto Now = std::chrono::high_resolution_clock::now();
-	SilenceDuration = (float)(std::chrono::duration_cast<std::chrono::milliseconds>(Now - LastSampleTimestamp).count() * 0.001);
+	if (RecordedBytes)
+	{
+		LastDataTime = Now;
+		LastDataPos = WritePos;
+	}
+
+	// device gaps count as silence by clock, otherwise last utterance waits for the next sound
+	uint64_t ClockPos = WritePos;
+	if (RecorderFile.empty() && !RecordedBytes)
+	{
+		ClockPos += (uint64_t)(std::chrono::duration<double>(Now - LastDataTime).count() * WhisperFormat.SampleRate);
+	}
+
+	SilenceDuration = (size_t)(ClockPos - std::min(LastSpeechPos, ClockPos)) / (float)WhisperFormat.SampleRate;
+	SegmentDuration = (size_t)(ClockPos - SegmentStartPos) / (float)WhisperFormat.SampleRate;
 
-	const size_t NumChunkSamples = SampleAccumulator.size();
-	SegmentDuration = NumChunkSamples / (float)WhisperFormat.SampleRate;
+	if (StreamMode || StreamActive)
+	{
+		PollStream(WritePos);
+	}
+	else
+	{
+		PollSegments(WritePos);
+	}
+
+	if (Recorder->IsFinished() && !StreamActive && (StreamMode || SegmentStartPos == WritePos))
+	{
+		ReplayDone = 1;
+	}
+}
+
+void WhisperSpeechToText::PollSegments(uint64_t WritePos)
+{
+	const size_t NumChunkSamples = (size_t)(WritePos - SegmentStartPos);
+	if (!NumChunkSamples)
+		return; // clock only advanced, nothing to split
 
 	if ((SegmentDuration > MinSegmentDuration && SilenceDuration > SplitSilenceDuration)
-		|| SegmentDuration > MaxSegmentDuration)
+		|| SegmentDuration > std::min(MaxSegmentDuration, MaxSegmentDurationLimit))
 	{
-		if (LastSampleTimestamp > LastProcessTimestamp)
+		if (LastSpeechPos > LastProcessPos)
 		{
-			LastProcessTimestamp = std::chrono::high_resolution_clock::now();
+			LastProcessPos = WritePos;
 
-			if (WhisperContext && WhisperThreadPool && !Paused && !ExitFlag)
+			if (WhisperThreadPool && !Paused && !ExitFlag)
+			{
+				SubmitSegment(SegmentStartPos, SegmentStartPos + NumChunkSamples);
+			}
+			else
+			{
+				ReleaseSamples(WritePos);
+			}
+		}
+		else
+		{
+			ReleaseSamples(WritePos);
+		}
+		SegmentStartPos = WritePos;
+	}
+
+	if (SilenceDuration > FlushSilenceDuration && WritePos > SegmentStartPos)
+	{
+		ReleaseSamples(WritePos);
+		SegmentStartPos = WritePos;
+	}
+}
+
+void WhisperSpeechToText::PollStream(uint64_t WritePos)
+{
+	const bool CanProcess = (WhisperThreadPool && !Paused && !ExitFlag);
+	const bool NewSpeech = (LastSpeechPos > LastProcessPos);
+	const size_t StepSamples = (size_t)(StreamStepDuration * WhisperFormat.SampleRate);
+
+	if (StreamActive && (!StreamMode || !CanProcess || SilenceDuration > SplitSilenceDuration))
+	{
+		// end of utterance, commit everything once pending step has landed (stream steps never overlap)
+		if (!StreamPending)
+		{
+			if (WhisperThreadPool)
 			{
-				auto Fut = WhisperThreadPool->submit_task([this, TaskBuffer = std::move(SampleAccumulator)]() mutable
+				StreamPending = 1;
+				auto Fut = WhisperThreadPool->submit_task([this, Seq = NextSeq++, StartPos = SegmentStartPos, WritePos, CaptureTime = GetCaptureTime(WritePos)]()
 				{
-					WhisperProcess(TaskBuffer);
+					StreamProcess(Seq, StartPos, WritePos, true, CaptureTime);
 				});
 			}
+			StreamActive = false;
+			SegmentStartPos = WritePos;
+			LastStreamPos = WritePos;
+		}
+	}
+	else if (CanProcess && NewSpeech && (WritePos - LastStreamPos) >= StepSamples && !StreamPending)
+	{
+		LastProcessPos = WritePos;
+		LastStreamPos = WritePos;
+		StreamActive = true;
+		StreamPending = 1;
+
+		auto Fut = WhisperThreadPool->submit_task([this, Seq = NextSeq++, StartPos = SegmentStartPos, WritePos, CaptureTime = GetCaptureTime(WritePos)]()
+		{
+			StreamProcess(Seq, StartPos, WritePos, false, CaptureTime);
+		});
+	}
+	else if (!StreamActive && !NewSpeech)
+	{
+		// idle, keep short preroll so utterance onset is not clipped
+		const size_t PrerollSamples = (size_t)(StreamPrerollDuration * WhisperFormat.SampleRate);
+		if ((WritePos - SegmentStartPos) > PrerollSamples + StepSamples)
+		{
+			SegmentStartPos = WritePos - PrerollSamples;
+			LastStreamPos = SegmentStartPos;
+			ReleaseSamples(SegmentStartPos);
+		}
+	}
+}
+
+void WhisperSpeechToText::ReleaseSamples(uint64_t EndPos)
+{
+	// consumed in order after every segment submitted before it
+	Deliver(NextSeq++, EndPos, nullptr);
+}
+
+// when sample Pos came out of the recorder, not when the split was decided (clock silence can be seconds later)
+std::chrono::high_resolution_clock::time_point WhisperSpeechToText::GetCaptureTime(uint64_t Pos) const
+{
+	const double Behind = (LastDataPos - std::min(Pos, LastDataPos)) / (double)WhisperFormat.SampleRate;
+	return LastDataTime - std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(std::chrono::duration<double>(Behind));
+}
+
+void WhisperSpeechToText::SubmitSegment(uint64_t StartPos, uint64_t EndPos)
+{
+	const SegmentJob Job { NextSeq++, StartPos, EndPos, GetCaptureTime(EndPos) };
+	SegmentJob DroppedJob {};
+	bool Dropped = false;
+	bool Accepted = true;
+	{
+		std::lock_guard<std::mutex> Lock(PendingMutex);
+		if (DropPolicyId != DropPolicyQueue && PendingSegments.size() >= (size_t)std::max(MaxPendingSegments, 1))
+		{
+			Dropped = true;
+			if (DropPolicyId == DropPolicyOldest && !PendingSegments.empty())
+			{
+				DroppedJob = PendingSegments.front();
+				PendingSegments.pop_front();
+			}
 			else
 			{
-				SampleAccumulator.resize(0);
+				DroppedJob = Job;
+				Accepted = false;
 			}
 		}
-		else
+		if (Accepted)
 		{
-			SampleAccumulator.resize(0);
+			PendingSegments.push_back(Job);
 		}
 	}
 
-	if (SilenceDuration > FlushSilenceDuration && SegmentDuration > 0.0f)
+	if (Dropped)
 	{
-		SampleAccumulator.resize(0);
+		NumDroppedSegments++;
+		logi("Decoders saturated, drop segment {:.1f} s", (DroppedJob.EndPos - DroppedJob.StartPos) / (float)WhisperFormat.SampleRate);
+		Deliver(DroppedJob.Seq, DroppedJob.EndPos, nullptr);
+	}
+
+	if (Accepted)
+	{
+		// one task per accepted job, task of a dropped job finds nothing to do
+		auto Fut = WhisperThreadPool->submit_task([this]()
+		{
+			RunPendingSegment();
+		});
 	}
 }
 
-void WhisperSpeechToText::WhisperProcess(const TRawArray<float>& InSamples)
+void WhisperSpeechToText::RunPendingSegment()
 {
+	SegmentJob Job {};
+	{
+		std::lock_guard<std::mutex> Lock(PendingMutex);
+		if (PendingSegments.empty())
+			return;
+		Job = PendingSegments.front();
+		PendingSegments.pop_front();
+	}
+
 	Result Res {};
+	Res.AudioStartPos = Job.StartPos;
+	Res.AudioEndPos = Job.EndPos;
+	Res.CaptureTime = Job.CaptureTime;
+
+	auto Eng = WaitEngine(); // model may still be loading, segment waits in SampleBuffer
+	if (!Eng)
+	{
+		if (!ExitFlag)
+		{
+			NumDroppedSegments++;
+			loge("No whisper model, drop segment {:.1f} s", (Job.EndPos - Job.StartPos) / (float)WhisperFormat.SampleRate);
+		}
+		Deliver(Job.Seq, Job.EndPos, nullptr);
+		return;
+	}
+
+	if (whisper_state* State = Eng->AcquireState())
+	{
+		WhisperProcess(*Eng, State, Job.StartPos, (size_t)(Job.EndPos - Job.StartPos), Res);
+		Eng->ReleaseState(State);
+	}
+
+	Deliver(Job.Seq, Job.EndPos, &Res);
+}
+
+void WhisperSpeechToText::Deliver(uint64_t Seq, uint64_t ConsumePos, Result* Res)
+{
+	std::lock_guard<std::mutex> Lock(DeliverMutex);
+
+	auto& Done = DoneJobs[Seq];
+	Done.ConsumePos = ConsumePos;
+	if (Res)
+	{
+		Done.HasResult = true;
+		Done.Res = std::move(*Res);
+	}
+
+	while (!DoneJobs.empty() && DoneJobs.begin()->first == NextDeliverSeq)
+	{
+		auto Node = DoneJobs.extract(DoneJobs.begin());
+		SampleBuffer.consume(Node.mapped().ConsumePos);
+		if (Node.mapped().HasResult && ResCallback)
+		{
+			ResCallback(Node.mapped().Res);
+		}
+		NextDeliverSeq++;
+	}
+}
+
+void WhisperSpeechToText::WhisperProcess(WhisperEngine& Eng, whisper_state* State, uint64_t SamplePos, size_t NumSamples, Result& Res)
+{
+	// zero copy, segment stays in SampleBuffer until delivered
+	const float* Samples = SampleBuffer.span(SamplePos, NumSamples);
+	if (!Samples)
+	{
+		loge("SampleBuffer.span Pos={} Num={}", SamplePos, NumSamples);
+		return;
+	}
 
 	// minimal buffer duration is 1.0s -> https://github.com/ggerganov/whisper.cpp/issues/39
-	const int Error = whisper_full_parallel(WhisperContext, WhisperFullParams, InSamples.data(), (int)InSamples.size(), NumProcessors);
+	const auto Clock0 = std::chrono::high_resolution_clock::now();
+	const int Error = whisper_full_with_state(Eng.Context, State, WhisperFullParams, Samples, (int)NumSamples);
+	Res.DecodeDuration = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - Clock0).count();
 	if (Error != 0)
 	{
-		loge("whisper_full_parallel Error={}", Error);
+		loge("whisper_full_with_state Error={}", Error);
+		return;
 	}
-	else
+
+	const int n_segments = whisper_full_n_segments_from_state(State);
+	for (int i = 0; i < n_segments; ++i)
 	{
-		const int n_segments = whisper_full_n_segments(WhisperContext);
-		for (int i = 0; i < n_segments; ++i)
+		const char* SegmentText = whisper_full_get_segment_text_from_state(State, i);
+		if (SegmentText)
 		{
-			#if 0
-			for (int j = 0; j < whisper_full_n_tokens(WhisperContext, i); ++j)
-			{
-				const char* TokenText = whisper_full_get_token_text(WhisperContext, i, j);
-				const float TokenP = whisper_full_get_token_p(WhisperContext, i, j);
+			Res.Segments.push_back(SegmentText);
+			Res.Text.append(SegmentText);
+		}
+	}
+}
 
-				logi("TOK # {} # P={}", TokenText, TokenP);
-			}
-			#endif
+void WhisperSpeechToText::StreamProcess(uint64_t Seq, uint64_t StartPos, uint64_t EndPos, bool Final, std::chrono::high_resolution_clock::time_point CaptureTime)
+{
+	struct PendingTerminator { std::atomic<int>* Flag; ~PendingTerminator() { *Flag = 0; } } PendingTerm { &StreamPending };
+
+	Result Res {};
+	Res.AudioEndPos = EndPos;
+	Res.CaptureTime = CaptureTime;
+	whisper_state* State = nullptr;
+
+	auto Eng = WaitEngine();
+	if (Eng && Eng->Generation != StreamGeneration) // model swapped, old prompt tokens mean nothing
+	{
+		StreamGeneration = Eng->Generation;
+		StreamTokens.clear();
+	}
+
+	if (StreamStartPos < StartPos) // new utterance
+	{
+		StreamStartPos = StartPos;
+		StreamSegments.clear();
+	}
+
+	const size_t SampleRate = WhisperFormat.SampleRate;
+	const size_t MaxWindow = std::min((size_t)(StreamContextDuration * SampleRate), SampleBuffer.max_span());
+	if (EndPos - StreamStartPos > MaxWindow)
+	{
+		loge("Stream window overflow, skip {} samples", (EndPos - StreamStartPos) - MaxWindow);
+		StreamStartPos = EndPos - MaxWindow;
+		StreamSegments.clear();
+	}
+
+	const size_t NumSamples = (size_t)(EndPos - StreamStartPos);
+	const float* Samples = SampleBuffer.span(StreamStartPos, NumSamples);
+	Res.AudioStartPos = StreamStartPos;
+
+	std::vector<std::string> Segments;
+	std::vector<int64_t> SegmentEnds;
+
+	// minimal buffer duration is 1.0s -> https://github.com/ggerganov/whisper.cpp/issues/39
+	if (Samples && NumSamples >= SampleRate && Eng && (State = Eng->AcquireState()) != nullptr)
+	{
+		whisper_full_params Params = WhisperFullParams;
+		Params.no_context = true; // context is passed explicitly via committed tokens
+		Params.single_segment = false;
+		Params.prompt_tokens = StreamTokens.empty() ? nullptr : StreamTokens.data();
+		Params.prompt_n_tokens = (int)StreamTokens.size();
 
-			const char* SegmentText = whisper_full_get_segment_text(WhisperContext, i);
-			if (SegmentText)
+		const auto Clock0 = std::chrono::high_resolution_clock::now();
+		const int Error = whisper_full_with_state(Eng->Context, State, Params, Samples, (int)NumSamples);
+		Res.DecodeDuration = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - Clock0).count();
+		if (Error != 0)
+		{
+			loge("whisper_full_with_state Error={}", Error);
+		}
+		else
+		{
+			const int n_segments = whisper_full_n_segments_from_state(State);
+			for (int i = 0; i < n_segments; ++i)
 			{
-				Res.Segments.push_back(SegmentText);
-				Res.Text.append(SegmentText);
+				const char* SegmentText = whisper_full_get_segment_text_from_state(State, i);
+				Segments.emplace_back(SegmentText ? SegmentText : "");
+				SegmentEnds.push_back(whisper_full_get_segment_t1_from_state(State, i)); // 10 ms units
 			}
 		}
 	}
+	else if (!Samples)
+	{
+		loge("SampleBuffer.span Pos={} Num={}", StreamStartPos, NumSamples);
+	}
+
+	// local agreement: segment is stable when two consecutive decodes agree, last one is still growing
+	const size_t NumSegments = Segments.size();
+	size_t NumCommit = 0;
+	if (Final)
+	{
+		NumCommit = NumSegments;
+	}
+	else
+	{
+		const size_t NumCandidates = (NumSegments ? NumSegments - 1 : 0);
+		while (NumCommit < NumCandidates && NumCommit < StreamSegments.size() && StreamSegments[NumCommit] == Segments[NumCommit])
+			++NumCommit;
+
+		const size_t StepSamples = (size_t)(StreamStepDuration * SampleRate);
+		if (NumSamples + StepSamples >= MaxWindow) // window is full, force commit
+			NumCommit = (NumSegments > 1 ? NumSegments - 1 : NumSegments);
+	}
+
+	for (size_t i = 0; i < NumCommit; ++i)
+	{
+		const int n_tokens = whisper_full_n_tokens_from_state(State, (int)i);
+		for (int j = 0; j < n_tokens; ++j)
+		{
+			const whisper_token Token = whisper_full_get_token_id_from_state(State, (int)i, j);
+			if (Token < whisper_token_eot(Eng->Context)) // text only
+				StreamTokens.push_back(Token);
+		}
+
+		Res.Text.append(Segments[i]);
+		Res.Segments.emplace_back(std::move(Segments[i]));
+	}
+
+	if (State)
+	{
+		Eng->ReleaseState(State);
+	}
+
+	if (StreamTokens.size() > (size_t)StreamPromptTokens)
+	{
+		StreamTokens.erase(StreamTokens.begin(), StreamTokens.end() - StreamPromptTokens);
+	}
+
+	if (Final)
+	{
+		StreamStartPos = EndPos;
+		StreamSegments.clear();
+	}
+	else
+	{
+		if (NumCommit)
+		{
+			const uint64_t CommitPos = StreamStartPos + (uint64_t)(SegmentEnds[NumCommit - 1] * SampleRate / 100);
+			StreamStartPos = std::clamp(CommitPos, StreamStartPos, EndPos);
+		}
+
+		StreamSegments.assign(std::make_move_iterator(Segments.begin() + NumCommit), std::make_move_iterator(Segments.end()));
+		for (const auto& Segment : StreamSegments)
+		{
+			Res.Tentative.append(Segment);
+		}
+	}
 
-	if (ResCallback)
-		ResCallback(Res);
+	Deliver(Seq, StreamStartPos, &Res);
 }
 
 void WhisperSpeechToText::Serialize(IniFile& Config, bool Save)
@@ -292,26 +1057,98 @@ void WhisperSpeechToText::Serialize(IniFile& Config, bool Save)
 	INI_SERIALIZE_PROP("Speech", NumProcessors);
 	INI_SERIALIZE_PROP("Speech", NumThreads);
 	INI_SERIALIZE_PROP("Speech", UseGpu);
+	INI_SERIALIZE_PROP("Speech", KeepStandbyModel);
+	INI_SERIALIZE_PROP("Speech", DropPolicy);
+	INI_SERIALIZE_PROP("Speech", MaxPendingSegments);
+	if (!Save)
+	{
+		MaxPendingSegments = std::max(MaxPendingSegments, 1); // 0 would drop every segment
+	}
+	INI_SERIALIZE_PROP("Speech", ResamplerQuality);
+	INI_SERIALIZE_PROP("Speech", RecorderFile);
+	INI_SERIALIZE_PROP("Speech", RecorderFileSpeed);
+	INI_SERIALIZE_PROP("Speech", RecorderFileChunk);
+	INI_SERIALIZE_PROP("Speech", RecorderFileLoop);
 
-	INI_SERIALIZE_PROP("Speech", SampleLevelThreshold);
+	INI_SERIALIZE_PROP("Speech", VoiceDetector);
 	INI_SERIALIZE_PROP("Speech", SplitSilenceDuration);
 	INI_SERIALIZE_PROP("Speech", FlushSilenceDuration);
 	INI_SERIALIZE_PROP("Speech", MinSegmentDuration);
 	INI_SERIALIZE_PROP("Speech", MaxSegmentDuration);
+	INI_SERIALIZE_PROP("Speech", SampleBufferDuration);
+
+	INI_SERIALIZE_PROP("Speech", StreamMode);
+	INI_SERIALIZE_PROP("Speech", StreamStepDuration);
+	INI_SERIALIZE_PROP("Speech", StreamContextDuration);
+	INI_SERIALIZE_PROP("Speech", StreamPrerollDuration);
+	INI_SERIALIZE_PROP("Speech", StreamPromptTokens);
+
+	for (auto& Detector : VoiceDetectors)
+	{
+		if (Detector)
+			Detector->Serialize(Config, Save);
+	}
 }
 
 void WhisperSpeechToText::RenderUI()
 {
 	ImGui::Checkbox("Paused", &Paused);
-	ImGui::SliderFloat("SampleLevelThreshold", &SampleLevelThreshold, 0.0f, 0.1f);
+
+	if (!ModelInput[0])
+	{
+		strncpy(ModelInput, WhisperModel.c_str(), sizeof(ModelInput) - 1);
+	}
+	ImGui::InputText("WhisperModel", ModelInput, sizeof(ModelInput));
+	ImGui::SameLine();
+	if (ImGui::Button("Load##WhisperModel") && !Loading && LoadModel(ModelInput))
+	{
+		WhisperModel = ModelInput; // hot swap, audio keeps buffering meanwhile
+	}
+	if (Loading)
+	{
+		ImGui::Text("Loading model...");
+	}
+	else if (LoadFailed)
+	{
+		std::lock_guard<std::mutex> Lock(EngineMutex);
+		ImGui::Text("%s%s", LoadError.c_str(), (Engine ? ", previous model stays" : ", segments are dropped"));
+	}
 	ImGui::SliderFloat("SplitSilenceDuration", &SplitSilenceDuration, 0.0f, 0.5f);
 	ImGui::SliderFloat("FlushSilenceDuration", &FlushSilenceDuration, SplitSilenceDuration + 0.1f, 30.0f);
 	ImGui::SliderFloat("MinSegmentDuration", &MinSegmentDuration, 1.0f, 10.0f);
-	ImGui::SliderFloat("MaxSegmentDuration", &MaxSegmentDuration, MinSegmentDuration + 0.1f, 30.0f);
+	ImGui::SliderFloat("MaxSegmentDuration", &MaxSegmentDuration, MinSegmentDuration + 0.1f, MaxSegmentDurationLimit);
+
+	ImGui::Checkbox("StreamMode", &StreamMode);
+	ImGui::SliderFloat("StreamStepDuration", &StreamStepDuration, 0.2f, 5.0f);
+	ImGui::SliderFloat("StreamContextDuration", &StreamContextDuration, StreamStepDuration + 1.0f, MaxSegmentDurationLimit);
 
 	ImGui::Text("SegmentDuration %f", SegmentDuration);
 	ImGui::Text("SilenceDuration %f", SilenceDuration);
 	ImGui::Text("%s", (Silent ? "Silent" : "Active"));
+
+	int DetectorId = VoiceDetectorId.load();
+	if (ImGui::Combo("VoiceDetector", &DetectorId, IVoiceDetector::Names, (int)NumVoiceDetectors))
+	{
+		if (VoiceDetectors[DetectorId])
+		{
+			VoiceDetector = IVoiceDetector::Names[DetectorId];
+			VoiceDetectorId = DetectorId;
+		}
+	}
+	if (auto& Detector = VoiceDetectors[VoiceDetectorId.load()])
+	{
+		Detector->RenderUI();
+		ImGui::Text("SpeechProb %.2f", Detector->GetSpeechProb());
+	}
+	if (ImGui::Combo("DropPolicy", &DropPolicyId, DropPolicyNames, (int)std::size(DropPolicyNames)))
+	{
+		DropPolicy = DropPolicyNames[DropPolicyId];
+	}
+	ImGui::SliderInt("MaxPendingSegments", &MaxPendingSegments, 1, 8);
+	ImGui::Text("Decoders %d x %d threads, dropped %d segments", std::clamp(NumProcessors, 1, 8), NumThreadsPerState, (int)NumDroppedSegments.load());
+	ImGui::Text("Buffered %.1f s, dropped %.1f s", 
+		SampleBuffer.size() / (float)WhisperFormat.SampleRate, 
+		SampleBuffer.overflow() / (float)WhisperFormat.SampleRate);
 }
 
 ISpeechToText* ISpeechToText::CreateInstance()
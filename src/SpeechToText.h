@@ -1,6 +1,7 @@
 #pragma once
 
 #include "IniFile.h"
+#include <chrono>
 
 class ISpeechToText
 {
@@ -10,8 +11,15 @@ public:
 
 	struct Result
 	{
-		std::vector<std::string> Segments;
+		std::vector<std::string> Segments; // committed
 		std::string Text;
+		std::string Tentative; // stream mode, may change with next result
+
+		// timing, positions are 16 kHz samples since Init
+		uint64_t AudioStartPos = 0;
+		uint64_t AudioEndPos = 0;
+		std::chrono::high_resolution_clock::time_point CaptureTime {}; // AudioEndPos entered the pipeline
+		float DecodeDuration = 0; // seconds in whisper
 
 		AUG_MOVABLE_NONCOPYABLE(Result);
 	};
@@ -23,4 +31,9 @@ public:
 	virtual void Release() = 0;
 	virtual void Serialize(IniFile& Config, bool Save) = 0;
 	virtual void RenderUI() = 0;
+	virtual bool IsDrained() const = 0; // file replay ended and every segment was delivered
+	virtual uint64_t GetNumDroppedSegments() const = 0; // since Init, by drop policy or missing model
+
+	enum class EModelStatus { Loading, Ready, Failed };
+	virtual EModelStatus GetModelStatus() const = 0; // Failed: segments are dropped until a model loads
 };
@@ -37,6 +37,16 @@ void TextEditor::setText(const std::string_view &text) {
 }
 
 
+//
+//	TextEditor::appendText
+//
+
+void TextEditor::appendText(const std::string_view &text) {
+	// only new glyphs get decoded and colorized, nothing else is reset
+	document.appendText(text);
+}
+
+
 //
 //	TextEditor::render
 //
@@ -3012,6 +3022,47 @@ TextEditor::Coordinate TextEditor::Document::insertText(Coordinate start, const
 }
 
 
+//
+//	TextEditor::Document::appendText
+//
+
+TextEditor::Coordinate TextEditor::Document::appendText(const std::string_view& text) {
+	auto first = lineCount() - 1;
+
+	// process input UTF-8 and add glyphs to the last line, new lines as needed
+	auto textEnd = text.end();
+	auto i = text.begin();
+
+	while (i < textEnd) {
+		ImWchar character;
+		i = CodePoint::read(i, textEnd, &character);
+
+		if (character == '\n') {
+			emplace_back();
+
+		} else if (character != '\r') {
+			back().emplace_back(Glyph(character, Color::text));
+		}
+	}
+
+	// mark affected lines for colorization and update maximum column counts (existing lines can't shrink)
+	for (auto line = begin() + first; line < end(); line++) {
+		int column = 0;
+
+		for (auto glyph = line->begin(); glyph < line->end(); glyph++) {
+			column = (glyph->codepoint == '\t') ? ((column / tabSize) + 1) * tabSize : column + 1;
+		}
+
+		line->maxColumn = column;
+		line->colorize = true;
+		maxColumn = std::max(maxColumn, column);
+	}
+
+	updated = true;
+	return getBottom();
+}
+
+
 //
 //	TextEditor::Document::deleteText
 //
@@ -75,6 +75,7 @@ public:
 	// access text (using UTF-8 encoded strings)
 	// (see note below on cursor and scroll manipulation after setting new text)
 	inline void SetText(const std::string_view& text) { setText(text); }
+	inline void AppendText(const std::string_view& text) { appendText(text); } // add to end without undo entry, existing lines and cursors stay as they are
 	inline std::string GetText() const { return document.getText(); }
 	inline std::string GetCursorText(size_t cursor) const { return getCursorText(cursor); }
 
@@ -680,6 +681,7 @@ protected:
 		void setText(const std::string_view& text);
 		void setText(const std::vector<std::string_view>& text);
 		Coordinate insertText(Coordinate start, const std::string_view& text);
+		Coordinate appendText(const std::string_view& text);
 		void deleteText(Coordinate start, Coordinate end);
 
 		// access document text (strings are UTF-8 encoded)
@@ -864,6 +866,7 @@ protected:
 
 	// access the editor's text
 	void setText(const std::string_view& text);
+	void appendText(const std::string_view& text);
 	void clearText();
 
 	// render (parts of) the text editor
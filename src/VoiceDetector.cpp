@@ -0,0 +1,540 @@
+#define AUG_ENABLE_SILERO_VAD 0 // requires whisper.cpp with VAD support and ggml-silero model
+// whisper_vad_detect_speech starts every call from zero LSTM state, so each frame is run again with ContextFrames of history
+
+#include "VoiceDetector.h"
+#include "WaveCore.h"
+
+#include <imgui.h>
+#include <cmath>
+#include <filesystem>
+
+#if (AUG_ENABLE_SILERO_VAD)
+#include <whisper.h>
+#endif
+
+static inline float Sigmoid(float x) { return 1.0f / (1.0f + expf(-x)); }
+
+//=================================================================================================
+// FRAMING + HANGOVER SMOOTHING
+
+class FrameVoiceDetector : public IVoiceDetector
+{
+public:
+
+	FrameVoiceDetector(const char* InSection) : Section(InSection) {}
+
+	virtual bool Init(uint32_t InSampleRate) override;
+	virtual void Release() override;
+	virtual void Reset() override;
+	virtual void Serialize(IniFile& Config, bool Save) override;
+	virtual void RenderUI() override;
+	virtual bool Process(const float* Samples, size_t NumSamples) override;
+	virtual const TRawArray<float>& GetFrameProbs() const override { return FrameProbs; }
+	virtual float GetSpeechProb() const override { return SpeechProb; }
+	virtual bool IsSpeech() const override { return Speech; }
+
+protected:
+
+	virtual size_t GetFrameSize(uint32_t InSampleRate) const;
+	virtual bool InitFrame() { return true; }
+	virtual float ProcessFrame(const float* Frame) = 0;
+	bool UpdateSpeech(float Prob);
+
+	const char* Section;
+
+	float SpeechThreshold = 0.5f;
+	float OnsetDuration = 0.03f; // reject clicks shorter than this
+	float HangoverDuration = 0.25f; // keep speech active through short pauses
+
+	uint32_t SampleRate = 0;
+	size_t FrameSize = 0;
+	float FrameDuration = 0;
+	int OnsetFrames = 0;
+	int HangoverFrames = 0;
+
+	TRawArray<float> Carry;
+	TRawArray<float> FrameProbs;
+
+	float SpeechProb = 0;
+	int OnsetCount = 0;
+	int HangoverCount = 0;
+	bool Speech = false;
+};
+
+size_t FrameVoiceDetector::GetFrameSize(uint32_t InSampleRate) const
+{
+	// ~16 ms, power of two for spectral analysis
+	size_t Size = 64;
+	while (Size * 1000 < InSampleRate * 16) { Size <<= 1; }
+	return Size;
+}
+
+bool FrameVoiceDetector::Init(uint32_t InSampleRate)
+{
+	do
+	{
+		GUARD_BREAK(InSampleRate, "Invalid SampleRate");
+
+		SampleRate = InSampleRate;
+		FrameSize = GetFrameSize(SampleRate);
+		FrameDuration = FrameSize / (float)SampleRate;
+
+		Carry.reserve(FrameSize);
+		FrameProbs.reserve(64);
+
+		GUARD_BREAK(InitFrame(), "InitFrame");
+
+		Reset();
+		return true;
+	}
+	while (0);
+
+	Release();
+	return false;
+}
+
+void FrameVoiceDetector::Release()
+{
+	Carry.dealloc();
+	FrameProbs.dealloc();
+	SampleRate = 0;
+	FrameSize = 0;
+}
+
+void FrameVoiceDetector::Reset()
+{
+	OnsetFrames = (int)(OnsetDuration / std::max(FrameDuration, 0.001f));
+	HangoverFrames = (int)(HangoverDuration / std::max(FrameDuration, 0.001f));
+
+	Carry.clear();
+	FrameProbs.clear();
+	SpeechProb = 0;
+	OnsetCount = 0;
+	HangoverCount = 0;
+	Speech = false;
+}
+
+void FrameVoiceDetector::Serialize(IniFile& Config, bool Save)
+{
+	INI_SERIALIZE_PROP(Section, SpeechThreshold);
+	INI_SERIALIZE_PROP(Section, OnsetDuration);
+	INI_SERIALIZE_PROP(Section, HangoverDuration);
+}
+
+void FrameVoiceDetector::RenderUI()
+{
+	ImGui::SliderFloat("SpeechThreshold", &SpeechThreshold, 0.05f, 0.95f);
+	const bool b1 = ImGui::SliderFloat("OnsetDuration", &OnsetDuration, 0.0f, 0.2f);
+	const bool b2 = ImGui::SliderFloat("HangoverDuration", &HangoverDuration, 0.0f, 1.0f);
+	if (b1 || b2)
+	{
+		OnsetFrames = (int)(OnsetDuration / std::max(FrameDuration, 0.001f));
+		HangoverFrames = (int)(HangoverDuration / std::max(FrameDuration, 0.001f));
+	}
+}
+
+bool FrameVoiceDetector::UpdateSpeech(float Prob)
+{
+	if (Prob >= SpeechThreshold)
+	{
+		if (Speech || ++OnsetCount > OnsetFrames)
+		{
+			Speech = true;
+			HangoverCount = HangoverFrames;
+		}
+	}
+	else
+	{
+		OnsetCount = 0;
+		if (Speech && HangoverCount-- <= 0)
+		{
+			Speech = false;
+		}
+	}
+	return Speech;
+}
+
+bool FrameVoiceDetector::Process(const float* Samples, size_t NumSamples)
+{
+	FrameProbs.clear();
+
+	if (!FrameSize)
+		return false;
+
+	bool AnySpeech = false;
+	auto Consume = [&](const float* Frame)
+	{
+		SpeechProb = ProcessFrame(Frame);
+		FrameProbs.append(&SpeechProb, 1);
+		AnySpeech |= UpdateSpeech(SpeechProb);
+	};
+
+	// complete frame left over from previous chunk
+	if (Carry.size())
+	{
+		const size_t NumFill = std::min(FrameSize - Carry.size(), NumSamples);
+		Carry.append(Samples, NumFill);
+		Samples += NumFill;
+		NumSamples -= NumFill;
+
+		if (Carry.size() < FrameSize)
+			return Speech;
+
+		Consume(Carry.data());
+		Carry.clear();
+	}
+
+	// whole frames straight from input
+	for (; NumSamples >= FrameSize; Samples += FrameSize, NumSamples -= FrameSize)
+	{
+		Consume(Samples);
+	}
+
+	Carry.append(Samples, NumSamples);
+
+	return AnySpeech || (FrameProbs.size() == 0 && Speech);
+}
+
+//=================================================================================================
+// PEAK LEVEL (legacy behaviour)
+
+class LevelVoiceDetector : public FrameVoiceDetector
+{
+public:
+
+	LevelVoiceDetector() : FrameVoiceDetector("VadLevel")
+	{
+		OnsetDuration = 0.0f;
+		HangoverDuration = 0.0f;
+	}
+
+	virtual void Serialize(IniFile& Config, bool Save) override
+	{
+		FrameVoiceDetector::Serialize(Config, Save);
+		INI_SERIALIZE_PROP("Speech", SampleLevelThreshold); // keep old key
+	}
+
+	virtual void RenderUI() override
+	{
+		ImGui::SliderFloat("SampleLevelThreshold", &SampleLevelThreshold, 0.0f, 0.1f);
+		FrameVoiceDetector::RenderUI();
+	}
+
+protected:
+
+	virtual float ProcessFrame(const float* Frame) override
+	{
+		return (PeakAbs(Frame, FrameSize) > SampleLevelThreshold ? 1.0f : 0.0f);
+	}
+
+	float SampleLevelThreshold = 0.005f;
+};
+
+//=================================================================================================
+// RMS ENERGY OVER ADAPTIVE NOISE FLOOR + ZERO CROSSING RATE
+
+class EnergyVoiceDetector : public FrameVoiceDetector
+{
+public:
+
+	EnergyVoiceDetector(const char* InSection = "VadEnergy") : FrameVoiceDetector(InSection) {}
+
+	virtual void Reset() override
+	{
+		FrameVoiceDetector::Reset();
+		NoiseFloorDb = MinLevelDb;
+	}
+
+	virtual void Serialize(IniFile& Config, bool Save) override
+	{
+		FrameVoiceDetector::Serialize(Config, Save);
+		INI_SERIALIZE_PROP(Section, MinLevelDb);
+		INI_SERIALIZE_PROP(Section, SnrThresholdDb);
+		INI_SERIALIZE_PROP(Section, NoiseAdaptDuration);
+		INI_SERIALIZE_PROP(Section, ZcrThreshold);
+	}
+
+	virtual void RenderUI() override
+	{
+		ImGui::SliderFloat("MinLevelDb", &MinLevelDb, -90.0f, -20.0f);
+		ImGui::SliderFloat("SnrThresholdDb", &SnrThresholdDb, 0.0f, 30.0f);
+		ImGui::SliderFloat("NoiseAdaptDuration", &NoiseAdaptDuration, 0.5f, 30.0f);
+		ImGui::SliderFloat("ZcrThreshold", &ZcrThreshold, 0.05f, 0.5f);
+		FrameVoiceDetector::RenderUI();
+		ImGui::Text("NoiseFloor %.1f dB Level %.1f dB Zcr %.3f", NoiseFloorDb, LevelDb, Zcr);
+	}
+
+protected:
+
+	virtual float ProcessFrame(const float* Frame) override
+	{
+		LevelDb = 10.0f * log10f(SumSquares(Frame, FrameSize) / FrameSize + 1e-12f);
+		Zcr = ZeroCrossings(Frame, FrameSize) / (float)FrameSize;
+
+		// floor follows quiet frames fast and loud frames slow, even slower while talking
+		const float Rate = FrameDuration / std::max(NoiseAdaptDuration, 0.1f);
+		if (LevelDb < NoiseFloorDb)
+			NoiseFloorDb += (LevelDb - NoiseFloorDb) * 0.5f;
+		else
+			NoiseFloorDb += (LevelDb - NoiseFloorDb) * (Speech ? Rate * 0.1f : Rate);
+		NoiseFloorDb = std::max(NoiseFloorDb, -100.0f);
+
+		if (LevelDb < MinLevelDb)
+			return 0.0f;
+
+		const float SnrProb = Sigmoid((LevelDb - NoiseFloorDb - SnrThresholdDb) * 0.5f);
+		const float ZcrProb = Sigmoid((ZcrThreshold - Zcr) * 30.0f); // broadband noise and hiss cross zero a lot
+		return SnrProb * ZcrProb;
+	}
+
+	float MinLevelDb = -50.0f;
+	float SnrThresholdDb = 9.0f;
+	float NoiseAdaptDuration = 3.0f;
+	float ZcrThreshold = 0.3f;
+
+	float NoiseFloorDb = -50.0f;
+	float LevelDb = -100.0f;
+	float Zcr = 0.0f;
+};
+
+//=================================================================================================
+// ENERGY + SPECTRAL FLATNESS (speech is harmonic, noise is flat)
+
+class SpectralVoiceDetector : public EnergyVoiceDetector
+{
+public:
+
+	SpectralVoiceDetector() : EnergyVoiceDetector("VadSpectral") {}
+
+	virtual void Serialize(IniFile& Config, bool Save) override
+	{
+		EnergyVoiceDetector::Serialize(Config, Save);
+		INI_SERIALIZE_PROP(Section, FlatnessThreshold);
+	}
+
+	virtual void RenderUI() override
+	{
+		ImGui::SliderFloat("FlatnessThreshold", &FlatnessThreshold, 0.05f, 0.9f);
+		EnergyVoiceDetector::RenderUI();
+		ImGui::Text("Flatness %.3f", Flatness);
+	}
+
+protected:
+
+	virtual bool InitFrame() override;
+	virtual float ProcessFrame(const float* Frame) override;
+	void PowerSpectrum(const float* Frame);
+
+	float FlatnessThreshold = 0.45f;
+	float Flatness = 0.0f;
+
+	size_t NumBits = 0;
+	size_t BinLo = 0, BinHi = 0;
+	std::vector<uint32_t> BitRev;
+	TRawArray<float> Window, Cos, Sin, Re, Im;
+};
+
+bool SpectralVoiceDetector::InitFrame()
+{
+	const size_t n = FrameSize;
+
+	NumBits = 0;
+	while (((size_t)1 << NumBits) < n) { NumBits++; }
+	if (((size_t)1 << NumBits) != n)
+		return false;
+
+	BitRev.resize(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		uint32_t r = 0;
+		for (size_t b = 0; b < NumBits; ++b)
+			r |= ((i >> b) & 1) << (NumBits - 1 - b);
+		BitRev[i] = r;
+	}
+
+	const float Pi = 3.14159265358979f;
+	Window.resize(n);
+	Cos.resize(n / 2);
+	Sin.resize(n / 2);
+	Re.resize(n);
+	Im.resize(n);
+
+	for (size_t i = 0; i < n; ++i)
+		Window[i] = 0.5f - 0.5f * cosf(2.0f * Pi * i / (float)n); // hann
+
+	for (size_t i = 0; i < n / 2; ++i)
+	{
+		Cos[i] = cosf(2.0f * Pi * i / (float)n);
+		Sin[i] = -sinf(2.0f * Pi * i / (float)n);
+	}
+
+	// voice band 100..4000 Hz
+	BinLo = std::max<size_t>(1, (size_t)(100.0f * n / SampleRate));
+	BinHi = std::min<size_t>(n / 2, (size_t)(4000.0f * n / SampleRate) + 1);
+	return BinHi > BinLo;
+}
+
+void SpectralVoiceDetector::PowerSpectrum(const float* Frame)
+{
+	// radix-2 in place, real input
+	const size_t n = FrameSize;
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		Re[BitRev[i]] = Frame[i] * Window[i];
+		Im[i] = 0.0f;
+	}
+
+	for (size_t Len = 2; Len <= n; Len <<= 1)
+	{
+		const size_t Half = Len >> 1;
+		const size_t Step = n / Len;
+		for (size_t i = 0; i < n; i += Len)
+		{
+			for (size_t j = 0; j < Half; ++j)
+			{
+				const float wr = Cos[j * Step];
+				const float wi = Sin[j * Step];
+				const size_t a = i + j;
+				const size_t b = a + Half;
+				const float tr = Re[b] * wr - Im[b] * wi;
+				const float ti = Re[b] * wi + Im[b] * wr;
+				Re[b] = Re[a] - tr;
+				Im[b] = Im[a] - ti;
+				Re[a] += tr;
+				Im[a] += ti;
+			}
+		}
+	}
+
+	for (size_t k = BinLo; k < BinHi; ++k)
+	{
+		Re[k] = Re[k] * Re[k] + Im[k] * Im[k] + 1e-12f;
+	}
+}
+
+float SpectralVoiceDetector::ProcessFrame(const float* Frame)
+{
+	const float EnergyProb = EnergyVoiceDetector::ProcessFrame(Frame);
+	if (EnergyProb < 0.01f) // dont bother with fft on silence
+	{
+		Flatness = 1.0f;
+		return EnergyProb;
+	}
+
+	PowerSpectrum(Frame);
+
+	// geometric mean / arithmetic mean
+	double LogSum = 0.0;
+	double Sum = 0.0;
+	for (size_t k = BinLo; k < BinHi; ++k)
+	{
+		LogSum += logf(Re[k]);
+		Sum += Re[k];
+	}
+	const double NumBins = (double)(BinHi - BinLo);
+	Flatness = (float)(exp(LogSum / NumBins) / (Sum / NumBins));
+
+	return EnergyProb * Sigmoid((FlatnessThreshold - Flatness) * 20.0f);
+}
+
+//=================================================================================================
+// SILERO (whisper.cpp VAD)
+
+#if (AUG_ENABLE_SILERO_VAD)
+
+class SileroVoiceDetector : public FrameVoiceDetector
+{
+public:
+
+	SileroVoiceDetector() : FrameVoiceDetector("VadSilero") {}
+	virtual ~SileroVoiceDetector() override { Release(); }
+
+	virtual void Release() override
+	{
+		if (VadContext)
+		{
+			whisper_vad_free(VadContext);
+			VadContext = nullptr;
+		}
+		History.dealloc();
+		FrameVoiceDetector::Release();
+	}
+
+	virtual void Reset() override
+	{
+		History.clear(); // no context across utterance restarts either
+		FrameVoiceDetector::Reset();
+	}
+
+	virtual void Serialize(IniFile& Config, bool Save) override
+	{
+		FrameVoiceDetector::Serialize(Config, Save);
+		INI_SERIALIZE_PROP(Section, SileroModel);
+		INI_SERIALIZE_PROP(Section, ContextFrames);
+	}
+
+protected:
+
+	virtual size_t GetFrameSize(uint32_t InSampleRate) const override { return 512; } // 32 ms at 16 kHz
+
+	virtual bool InitFrame() override
+	{
+		if (SampleRate != 16000)
+		{
+			loge("Silero requires 16 kHz input");
+			return false;
+		}
+
+		if (!std::filesystem::exists(SileroModel))
+		{
+			loge("File not found: {}", SileroModel);
+			return false;
+		}
+
+		ContextFrames = std::clamp(ContextFrames, 0, 64);
+		History.reserve((ContextFrames + 1) * FrameSize);
+
+		whisper_vad_context_params Params = whisper_vad_default_context_params();
+		Params.n_threads = 1;
+		VadContext = whisper_vad_init_from_file_with_params(SileroModel.c_str(), Params);
+		return VadContext != nullptr;
+	}
+
+	// state is rebuilt from the history every frame, probability of the last chunk is the one with context
+	virtual float ProcessFrame(const float* Frame) override
+	{
+		const size_t MaxHistory = (ContextFrames + 1) * FrameSize;
+		if (History.size() >= MaxHistory)
+		{
+			memmove(History.data(), History.data() + FrameSize, (MaxHistory - FrameSize) * sizeof(float));
+			History.resize(MaxHistory - FrameSize);
+		}
+		History.append(Frame, FrameSize);
+
+		if (!whisper_vad_detect_speech(VadContext, History.data(), (int)History.size()))
+			return 0.0f;
+		const int NumProbs = whisper_vad_n_probs(VadContext);
+		return NumProbs > 0 ? whisper_vad_probs(VadContext)[NumProbs - 1] : 0.0f;
+	}
+
+	std::string SileroModel = "models/ggml-silero-v5.1.2.bin";
+	int ContextFrames = 15; // ~0.5 s, cost per frame grows with it
+	whisper_vad_context* VadContext = nullptr;
+	TRawArray<float> History; // last ContextFrames + 1 frames
+};
+
+#endif // AUG_ENABLE_SILERO_VAD
+
+//=================================================================================================
+
+IVoiceDetector* IVoiceDetector::CreateInstance(const std::string& Name)
+{
+	if (Name == "Level") return new LevelVoiceDetector();
+	if (Name == "Energy") return new EnergyVoiceDetector();
+	if (Name == "Spectral") return new SpectralVoiceDetector();
+	#if (AUG_ENABLE_SILERO_VAD)
+	if (Name == "Silero") return new SileroVoiceDetector();
+	#endif
+	return nullptr;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "RawArray.h"
+#include "IniFile.h"
+
+class IVoiceDetector
+{
+public:
+
+	static constexpr const char* Names[] = {"Level", "Energy", "Spectral", "Silero"};
+	static IVoiceDetector* CreateInstance(const std::string& Name);
+
+	virtual ~IVoiceDetector() {}
+	virtual bool Init(uint32_t SampleRate) = 0;
+	virtual void Release() = 0;
+	virtual void Reset() = 0;
+	virtual void Serialize(IniFile& Config, bool Save) = 0;
+	virtual void RenderUI() = 0;
+
+	// true when any frame of the chunk is speech (after hangover smoothing)
+	virtual bool Process(const float* Samples, size_t NumSamples) = 0;
+
+	// speech probability of every frame completed by last Process
+	virtual const TRawArray<float>& GetFrameProbs() const = 0;
+	virtual float GetSpeechProb() const = 0;
+	virtual bool IsSpeech() const = 0;
+};
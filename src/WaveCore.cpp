@@ -46,44 +46,135 @@ void SaveWave(const char* Filename, const WaveFormat& Format, const TRawArray<fl
 	}
 }
 
+bool ParseWave(const uint8_t* Data, size_t Size, WaveFormat& OutFormat, size_t& OutDataOffset, size_t& OutDataSize)
+{
+	if (Size < 12 || memcmp(Data, "RIFF", 4) || memcmp(Data + 8, "WAVE", 4))
+		return false;
+
+	bool HasFormat = false;
+	size_t Offset = 12;
+	while (Offset + 8 <= Size)
+	{
+		const uint8_t* Chunk = Data + Offset;
+		uint32_t ChunkSize = 0;
+		memcpy(&ChunkSize, Chunk + 4, 4);
+		const size_t ChunkDataOffset = Offset + 8;
+		const size_t ChunkDataSize = std::min((size_t)ChunkSize, Size - ChunkDataOffset); // tolerate truncated files
+
+		if (!memcmp(Chunk, "fmt ", 4) && ChunkDataSize >= 16)
+		{
+			uint16_t AudioFormat, NumChannels, BitsPerSample;
+			uint32_t SampleRate;
+			memcpy(&AudioFormat, Chunk + 8, 2);
+			memcpy(&NumChannels, Chunk + 10, 2);
+			memcpy(&SampleRate, Chunk + 12, 4);
+			memcpy(&BitsPerSample, Chunk + 22, 2);
+
+			if (AudioFormat == 0xFFFE && ChunkDataSize >= 26) // WAVE_FORMAT_EXTENSIBLE, first 2 bytes of SubFormat GUID
+				memcpy(&AudioFormat, Chunk + 8 + 24, 2);
+
+			OutFormat = {};
+			OutFormat.Format = (AudioFormat == 1 ? EWaveFormat::PCM : (AudioFormat == 3 ? EWaveFormat::FLOAT : EWaveFormat::UNSUPPORTED));
+			OutFormat.NumChannels = NumChannels;
+			OutFormat.SampleRate = SampleRate;
+			OutFormat.BitsPerSample = BitsPerSample;
+			OutFormat.ComputeBlockAlign();
+			HasFormat = true;
+		}
+		else if (!memcmp(Chunk, "data", 4) && HasFormat)
+		{
+			OutDataOffset = ChunkDataOffset;
+			OutDataSize = OutFormat.BlockAlign ? (ChunkDataSize / OutFormat.BlockAlign) * OutFormat.BlockAlign : 0;
+			return OutFormat.Format != EWaveFormat::UNSUPPORTED && OutFormat.BlockAlign;
+		}
+
+		Offset = ChunkDataOffset + ChunkSize + (ChunkSize & 1); // chunks are word aligned
+	}
+
+	return false;
+}
+
+bool LoadWave(const char* Filename, WaveFormat& OutFormat, TRawArray<uint8_t>& OutBytes)
+{
+	std::ifstream inFile(Filename, std::ios::binary | std::ios::ate);
+	if (!inFile)
+		return false;
+
+	TRawArray<uint8_t> FileBytes;
+	FileBytes.resize((size_t)inFile.tellg());
+	inFile.seekg(0);
+	inFile.read((char*)FileBytes.data(), FileBytes.size());
+
+	size_t DataOffset = 0, DataSize = 0;
+	if (!ParseWave(FileBytes.data(), FileBytes.size(), OutFormat, DataOffset, DataSize))
+		return false;
+
+	OutBytes.copy(FileBytes.data() + DataOffset, DataSize);
+	return true;
+}
+
 // NICE TO HAVE 9000 GHZ CPU
 
+template<typename T>
+static void ZeroTail(T* Dst, size_t Num, size_t DstCount)
+{
+	if (DstCount > Num)
+		memset(Dst + Num, 0, (DstCount - Num) * sizeof(T));
+}
+
 void S16toF32(const int16_t* Src, size_t SrcCount, float* Dst, size_t DstCount)
 {
 	const size_t Num = std::min(SrcCount, DstCount);
+	GetWaveKernels().S16toF32(Src, Dst, Num);
+	ZeroTail(Dst, Num, DstCount);
+}
 
-	for (size_t i = 0; i < Num; ++i)
-	{
-		Dst[i] = float(Src[i]) / 32768.0f;
-	}
+void S24toF32(const uint8_t* Src, size_t SrcCount, float* Dst, size_t DstCount)
+{
+	const size_t Num = std::min(SrcCount, DstCount);
+	GetWaveKernels().S24toF32(Src, Dst, Num);
+	ZeroTail(Dst, Num, DstCount);
+}
 
-	for (size_t i = Num; i < DstCount; ++i)
-	{
-		Dst[i] = 0.0f;
-	}
+void S32toF32(const int32_t* Src, size_t SrcCount, float* Dst, size_t DstCount)
+{
+	const size_t Num = std::min(SrcCount, DstCount);
+	GetWaveKernels().S32toF32(Src, Dst, Num);
+	ZeroTail(Dst, Num, DstCount);
 }
 
 void F32toS16(const float* Src, size_t SrcCount, int16_t* Dst, size_t DstCount)
 {
 	const size_t Num = std::min(SrcCount, DstCount);
-
-	for (size_t i = 0; i < Num; ++i)
-	{
-		Dst[i] = (int16_t)(Src[i] * 32768.0f);
-	}
-
-	for (size_t i = Num; i < DstCount; ++i)
-	{
-		Dst[i] = 0;
-	}
+	GetWaveKernels().F32toS16(Src, Dst, Num);
+	ZeroTail(Dst, Num, DstCount);
 }
 
 void Stereo2Mono(const float* Src, size_t SrcCount, TRawArray<float>& Dst)
 {
 	Dst.resize(SrcCount / 2);
+	GetWaveKernels().Downmix(Src, Dst.data(), SrcCount / 2, 2);
+}
 
-	for (size_t i = 0, j = 0; i < SrcCount; i += 2, j++)
-	{
-		Dst[j] = (Src[i] + Src[i + 1]) * 0.5f;
-	}
+void DownmixToMono(const float* Src, size_t NumFrames, uint32_t NumChannels, float* Dst)
+{
+	if (NumChannels == 1)
+		memcpy(Dst, Src, NumFrames * sizeof(float));
+	else if (NumChannels > 1)
+		GetWaveKernels().Downmix(Src, Dst, NumFrames, NumChannels);
+}
+
+float SumSquares(const float* Src, size_t Count)
+{
+	return GetWaveKernels().SumSquares(Src, Count);
+}
+
+float PeakAbs(const float* Src, size_t Count)
+{
+	return GetWaveKernels().PeakAbs(Src, Count);
+}
+
+size_t ZeroCrossings(const float* Src, size_t Count)
+{
+	return (Count > 1 ? GetWaveKernels().ZeroCrossings(Src, Count) : 0);
 }
@@ -42,7 +42,34 @@ struct WaveHeader // http://soundfile.sapp.org/doc/WaveFormat/
 #pragma pack(pop)
 
 void SaveWave(const char* Filename, const WaveFormat& Format, const TRawArray<float>& Samples);
+bool ParseWave(const uint8_t* Data, size_t Size, WaveFormat& OutFormat, size_t& OutDataOffset, size_t& OutDataSize); // RIFF in memory, skips unknown chunks
+bool LoadWave(const char* Filename, WaveFormat& OutFormat, TRawArray<uint8_t>& OutBytes);
 
 void S16toF32(const int16_t* Src, size_t SrcCount, float* Dst, size_t DstCount);
-void F32toS16(const float* Src, size_t SrcCount, int16_t* Dst, size_t DstCount);
+void S24toF32(const uint8_t* Src, size_t SrcCount, float* Dst, size_t DstCount); // packed 3 byte samples
+void S32toF32(const int32_t* Src, size_t SrcCount, float* Dst, size_t DstCount);
+void F32toS16(const float* Src, size_t SrcCount, int16_t* Dst, size_t DstCount); // saturating
 void Stereo2Mono(const float* Src, size_t SrcCount, TRawArray<float>& Dst);
+void DownmixToMono(const float* Src, size_t NumFrames, uint32_t NumChannels, float* Dst); // interleaved
+
+// frame analysis
+float SumSquares(const float* Src, size_t Count);
+float PeakAbs(const float* Src, size_t Count);
+size_t ZeroCrossings(const float* Src, size_t Count);
+
+// vectorized kernels, selected at runtime (WaveKernels.cpp)
+struct WaveKernels
+{
+	const char* Name;
+	void (*S16toF32)(const int16_t* Src, float* Dst, size_t Count);
+	void (*S24toF32)(const uint8_t* Src, float* Dst, size_t Count);
+	void (*S32toF32)(const int32_t* Src, float* Dst, size_t Count);
+	void (*F32toS16)(const float* Src, int16_t* Dst, size_t Count);
+	void (*Downmix)(const float* Src, float* Dst, size_t NumFrames, uint32_t NumChannels);
+	float (*SumSquares)(const float* Src, size_t Count);
+	float (*PeakAbs)(const float* Src, size_t Count);
+	size_t (*ZeroCrossings)(const float* Src, size_t Count);
+};
+
+const WaveKernels& GetWaveKernels(); // best supported by this cpu
+std::vector<const WaveKernels*> GetSupportedWaveKernels(); // scalar reference first
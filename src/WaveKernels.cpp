@@ -0,0 +1,578 @@
+#include "WaveCore.h"
+
+#include <cmath>
+
+// SAME MATH, MORE LANES
+// Every kernel has a scalar reference, vector variants must match it (bench_wave checks that).
+// Variants are picked once at runtime, tables may mix levels when a kernel has no faster version.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+	#define AUG_X86 1
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+	#endif
+#endif
+
+// AArch64 only (vcvtnq, vqmovn_high), 32-bit ARM stays scalar
+#if (defined(__ARM_NEON) && defined(__aarch64__)) || defined(_M_ARM64)
+	#define AUG_NEON 1
+	#include <arm_neon.h>
+#endif
+
+#if defined(AUG_X86) && (defined(__GNUC__) || defined(__clang__))
+	#define AUG_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+	#define AUG_TARGET_AVX2
+#endif
+
+static constexpr float S16Scale = 1.0f / 32768.0f;
+static constexpr float S24Scale = 1.0f / 8388608.0f;
+static constexpr float S32Scale = 1.0f / 2147483648.0f;
+
+//=================================================================================================
+// SCALAR
+
+static void S16toF32_Scalar(const int16_t* Src, float* Dst, size_t Count)
+{
+	for (size_t i = 0; i < Count; ++i)
+	{
+		Dst[i] = (float)Src[i] * S16Scale;
+	}
+}
+
+static inline int32_t LoadS24(const uint8_t* Src)
+{
+	return (int32_t)(((uint32_t)Src[0] << 8) | ((uint32_t)Src[1] << 16) | ((uint32_t)Src[2] << 24)) >> 8;
+}
+
+static void S24toF32_Scalar(const uint8_t* Src, float* Dst, size_t Count)
+{
+	for (size_t i = 0; i < Count; ++i)
+	{
+		Dst[i] = (float)LoadS24(Src + i * 3) * S24Scale;
+	}
+}
+
+static void S32toF32_Scalar(const int32_t* Src, float* Dst, size_t Count)
+{
+	for (size_t i = 0; i < Count; ++i)
+	{
+		Dst[i] = (float)Src[i] * S32Scale;
+	}
+}
+
+static void F32toS16_Scalar(const float* Src, int16_t* Dst, size_t Count)
+{
+	for (size_t i = 0; i < Count; ++i)
+	{
+		const float x = std::clamp(Src[i] * 32768.0f, -32768.0f, 32767.0f); // saturate, dont wrap
+		Dst[i] = (int16_t)lrintf(x);
+	}
+}
+
+static void Downmix_Scalar(const float* Src, float* Dst, size_t NumFrames, uint32_t NumChannels)
+{
+	const float Scale = 1.0f / (float)NumChannels;
+
+	if (NumChannels == 2)
+	{
+		for (size_t i = 0; i < NumFrames; ++i)
+		{
+			Dst[i] = (Src[i * 2] + Src[i * 2 + 1]) * Scale;
+		}
+		return;
+	}
+
+	for (size_t i = 0; i < NumFrames; ++i, Src += NumChannels)
+	{
+		float Sum = 0.0f;
+		for (uint32_t c = 0; c < NumChannels; ++c)
+		{
+			Sum += Src[c];
+		}
+		Dst[i] = Sum * Scale;
+	}
+}
+
+static float SumSquares_Scalar(const float* Src, size_t Count)
+{
+	float Sum = 0.0f;
+	for (size_t i = 0; i < Count; ++i)
+	{
+		Sum += Src[i] * Src[i];
+	}
+	return Sum;
+}
+
+static float PeakAbs_Scalar(const float* Src, size_t Count)
+{
+	float Peak = 0.0f;
+	for (size_t i = 0; i < Count; ++i)
+	{
+		Peak = std::max(Peak, fabsf(Src[i]));
+	}
+	return Peak;
+}
+
+static size_t ZeroCrossings_Scalar(const float* Src, size_t Count)
+{
+	size_t Num = 0;
+	for (size_t i = 0; i + 1 < Count; ++i)
+	{
+		Num += (std::signbit(Src[i]) != std::signbit(Src[i + 1])) ? 1 : 0;
+	}
+	return Num;
+}
+
+//=================================================================================================
+// SSE2
+
+#if defined(AUG_X86)
+
+static inline float HorizontalSum(__m128 v)
+{
+	alignas(16) float Lanes[4];
+	_mm_store_ps(Lanes, v);
+	return (Lanes[0] + Lanes[1]) + (Lanes[2] + Lanes[3]);
+}
+
+static inline float HorizontalMax(__m128 v)
+{
+	alignas(16) float Lanes[4];
+	_mm_store_ps(Lanes, v);
+	return std::max(std::max(Lanes[0], Lanes[1]), std::max(Lanes[2], Lanes[3]));
+}
+
+static void S16toF32_SSE2(const int16_t* Src, float* Dst, size_t Count)
+{
+	const __m128 Scale = _mm_set1_ps(S16Scale);
+	size_t i = 0;
+	for (; i + 8 <= Count; i += 8)
+	{
+		const __m128i v = _mm_loadu_si128((const __m128i*)(Src + i));
+		const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16); // sign extend
+		const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+		_mm_storeu_ps(Dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), Scale));
+		_mm_storeu_ps(Dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), Scale));
+	}
+	S16toF32_Scalar(Src + i, Dst + i, Count - i);
+}
+
+static void S32toF32_SSE2(const int32_t* Src, float* Dst, size_t Count)
+{
+	const __m128 Scale = _mm_set1_ps(S32Scale);
+	size_t i = 0;
+	for (; i + 4 <= Count; i += 4)
+	{
+		const __m128i v = _mm_loadu_si128((const __m128i*)(Src + i));
+		_mm_storeu_ps(Dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), Scale));
+	}
+	S32toF32_Scalar(Src + i, Dst + i, Count - i);
+}
+
+static void F32toS16_SSE2(const float* Src, int16_t* Dst, size_t Count)
+{
+	// clamp before cvt, out of range cvt returns 0x80000000
+	const __m128 Scale = _mm_set1_ps(32768.0f);
+	const __m128 Lo = _mm_set1_ps(-32768.0f);
+	const __m128 Hi = _mm_set1_ps(32767.0f);
+	size_t i = 0;
+	for (; i + 8 <= Count; i += 8)
+	{
+		const __m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(Src + i), Scale), Lo), Hi);
+		const __m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(Src + i + 4), Scale), Lo), Hi);
+		const __m128i v = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+		_mm_storeu_si128((__m128i*)(Dst + i), v);
+	}
+	F32toS16_Scalar(Src + i, Dst + i, Count - i);
+}
+
+static void Downmix_SSE2(const float* Src, float* Dst, size_t NumFrames, uint32_t NumChannels)
+{
+	const __m128 Scale = _mm_set1_ps(1.0f / (float)NumChannels);
+	size_t i = 0;
+
+	if (NumChannels == 2)
+	{
+		for (; i + 4 <= NumFrames; i += 4)
+		{
+			const __m128 a = _mm_loadu_ps(Src + i * 2); // L0 R0 L1 R1
+			const __m128 b = _mm_loadu_ps(Src + i * 2 + 4); // L2 R2 L3 R3
+			const __m128 l = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+			const __m128 r = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+			_mm_storeu_ps(Dst + i, _mm_mul_ps(_mm_add_ps(l, r), Scale));
+		}
+	}
+	else if (NumChannels % 4 == 0) // quad, 5.1 padded, 7.1
+	{
+		const uint32_t NumVecs = NumChannels / 4;
+		for (; i < NumFrames; ++i)
+		{
+			const float* Frame = Src + i * NumChannels;
+			__m128 Acc = _mm_loadu_ps(Frame);
+			for (uint32_t v = 1; v < NumVecs; ++v)
+			{
+				Acc = _mm_add_ps(Acc, _mm_loadu_ps(Frame + v * 4));
+			}
+			Dst[i] = HorizontalSum(Acc) * (1.0f / (float)NumChannels);
+		}
+	}
+
+	Downmix_Scalar(Src + i * NumChannels, Dst + i, NumFrames - i, NumChannels);
+}
+
+static float SumSquares_SSE2(const float* Src, size_t Count)
+{
+	__m128 Acc0 = _mm_setzero_ps();
+	__m128 Acc1 = _mm_setzero_ps();
+	size_t i = 0;
+	for (; i + 8 <= Count; i += 8)
+	{
+		const __m128 x0 = _mm_loadu_ps(Src + i);
+		const __m128 x1 = _mm_loadu_ps(Src + i + 4);
+		Acc0 = _mm_add_ps(Acc0, _mm_mul_ps(x0, x0));
+		Acc1 = _mm_add_ps(Acc1, _mm_mul_ps(x1, x1));
+	}
+	return HorizontalSum(_mm_add_ps(Acc0, Acc1)) + SumSquares_Scalar(Src + i, Count - i);
+}
+
+static float PeakAbs_SSE2(const float* Src, size_t Count)
+{
+	const __m128 AbsMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	__m128 Acc = _mm_setzero_ps();
+	size_t i = 0;
+	for (; i + 4 <= Count; i += 4)
+	{
+		Acc = _mm_max_ps(Acc, _mm_and_ps(_mm_loadu_ps(Src + i), AbsMask));
+	}
+	return std::max(HorizontalMax(Acc), PeakAbs_Scalar(Src + i, Count - i));
+}
+
+static size_t ZeroCrossings_SSE2(const float* Src, size_t Count)
+{
+	static const uint8_t Bits4[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+	size_t Num = 0;
+	size_t i = 0;
+	for (; i + 5 <= Count; i += 4)
+	{
+		// sign change between neighbours
+		const __m128 a = _mm_loadu_ps(Src + i);
+		const __m128 b = _mm_loadu_ps(Src + i + 1);
+		Num += Bits4[_mm_movemask_ps(_mm_xor_ps(a, b))];
+	}
+	return Num + ZeroCrossings_Scalar(Src + i, Count - i);
+}
+
+//=================================================================================================
+// AVX2
+
+AUG_TARGET_AVX2 static float HorizontalSum256(__m256 v)
+{
+	return HorizontalSum(_mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+}
+
+AUG_TARGET_AVX2 static void S16toF32_AVX2(const int16_t* Src, float* Dst, size_t Count)
+{
+	const __m256 Scale = _mm256_set1_ps(S16Scale);
+	size_t i = 0;
+	for (; i + 16 <= Count; i += 16)
+	{
+		const __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(Src + i)));
+		const __m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(Src + i + 8)));
+		_mm256_storeu_ps(Dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), Scale));
+		_mm256_storeu_ps(Dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), Scale));
+	}
+	S16toF32_SSE2(Src + i, Dst + i, Count - i);
+}
+
+AUG_TARGET_AVX2 static void S24toF32_AVX2(const uint8_t* Src, float* Dst, size_t Count)
+{
+	// 8 samples = 24 bytes, load 32 so stop while 8 bytes of slack remain
+	const __m256 Scale = _mm256_set1_ps(S24Scale);
+	const __m256i Spread = _mm256_setr_epi32(0, 1, 2, 0, 3, 4, 5, 0); // bytes 0..11 -> low lane, 12..23 -> high lane
+	const __m256i Shuffle = _mm256_setr_epi8(
+		-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+		-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+	size_t i = 0;
+	for (; i + 11 <= Count; i += 8)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*)(Src + i * 3));
+		v = _mm256_permutevar8x32_epi32(v, Spread);
+		v = _mm256_srai_epi32(_mm256_shuffle_epi8(v, Shuffle), 8); // sign extend
+		_mm256_storeu_ps(Dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), Scale));
+	}
+	S24toF32_Scalar(Src + i * 3, Dst + i, Count - i);
+}
+
+AUG_TARGET_AVX2 static void S32toF32_AVX2(const int32_t* Src, float* Dst, size_t Count)
+{
+	const __m256 Scale = _mm256_set1_ps(S32Scale);
+	size_t i = 0;
+	for (; i + 8 <= Count; i += 8)
+	{
+		const __m256i v = _mm256_loadu_si256((const __m256i*)(Src + i));
+		_mm256_storeu_ps(Dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), Scale));
+	}
+	S32toF32_SSE2(Src + i, Dst + i, Count - i);
+}
+
+AUG_TARGET_AVX2 static void F32toS16_AVX2(const float* Src, int16_t* Dst, size_t Count)
+{
+	const __m256 Scale = _mm256_set1_ps(32768.0f);
+	const __m256 Lo = _mm256_set1_ps(-32768.0f);
+	const __m256 Hi = _mm256_set1_ps(32767.0f);
+	size_t i = 0;
+	for (; i + 16 <= Count; i += 16)
+	{
+		const __m256 a = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(Src + i), Scale), Lo), Hi);
+		const __m256 b = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(Src + i + 8), Scale), Lo), Hi);
+		__m256i v = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b)); // a0 b0 | a1 b1 per lane
+		v = _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3, 1, 2, 0));
+		_mm256_storeu_si256((__m256i*)(Dst + i), v);
+	}
+	F32toS16_SSE2(Src + i, Dst + i, Count - i);
+}
+
+AUG_TARGET_AVX2 static void Downmix_AVX2(const float* Src, float* Dst, size_t NumFrames, uint32_t NumChannels)
+{
+	if (NumChannels != 2)
+	{
+		Downmix_SSE2(Src, Dst, NumFrames, NumChannels);
+		return;
+	}
+
+	const __m256 Scale = _mm256_set1_ps(0.5f);
+	size_t i = 0;
+	for (; i + 8 <= NumFrames; i += 8)
+	{
+		const __m256 a = _mm256_loadu_ps(Src + i * 2); // frames 0..3
+		const __m256 b = _mm256_loadu_ps(Src + i * 2 + 8); // frames 4..7
+		const __m256 l = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)); // 0 1 4 5 | 2 3 6 7
+		const __m256 r = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+		__m256 m = _mm256_mul_ps(_mm256_add_ps(l, r), Scale);
+		m = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(m), _MM_SHUFFLE(3, 1, 2, 0)));
+		_mm256_storeu_ps(Dst + i, m);
+	}
+	Downmix_SSE2(Src + i * 2, Dst + i, NumFrames - i, NumChannels);
+}
+
+AUG_TARGET_AVX2 static float SumSquares_AVX2(const float* Src, size_t Count)
+{
+	__m256 Acc0 = _mm256_setzero_ps();
+	__m256 Acc1 = _mm256_setzero_ps();
+	size_t i = 0;
+	for (; i + 16 <= Count; i += 16)
+	{
+		const __m256 x0 = _mm256_loadu_ps(Src + i);
+		const __m256 x1 = _mm256_loadu_ps(Src + i + 8);
+		Acc0 = _mm256_add_ps(Acc0, _mm256_mul_ps(x0, x0));
+		Acc1 = _mm256_add_ps(Acc1, _mm256_mul_ps(x1, x1));
+	}
+	return HorizontalSum256(_mm256_add_ps(Acc0, Acc1)) + SumSquares_SSE2(Src + i, Count - i);
+}
+
+AUG_TARGET_AVX2 static float PeakAbs_AVX2(const float* Src, size_t Count)
+{
+	const __m256 AbsMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+	__m256 Acc = _mm256_setzero_ps();
+	size_t i = 0;
+	for (; i + 8 <= Count; i += 8)
+	{
+		Acc = _mm256_max_ps(Acc, _mm256_and_ps(_mm256_loadu_ps(Src + i), AbsMask));
+	}
+	const __m128 Acc4 = _mm_max_ps(_mm256_castps256_ps128(Acc), _mm256_extractf128_ps(Acc, 1));
+	return std::max(HorizontalMax(Acc4), PeakAbs_SSE2(Src + i, Count - i));
+}
+
+static bool CpuHasAvx2()
+{
+	#if defined(_MSC_VER)
+		int Regs[4] {};
+		__cpuid(Regs, 0);
+		if (Regs[0] < 7)
+			return false;
+
+		__cpuid(Regs, 1);
+		const bool OsXSave = (Regs[2] & (1 << 27)) != 0;
+		const bool Avx = (Regs[2] & (1 << 28)) != 0;
+		if (!OsXSave || !Avx)
+			return false;
+
+		if ((_xgetbv(0) & 0x6) != 0x6) // OS saves YMM state
+			return false;
+
+		__cpuidex(Regs, 7, 0);
+		return (Regs[1] & (1 << 5)) != 0;
+	#else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+	#endif
+}
+
+#endif // AUG_X86
+
+//=================================================================================================
+// NEON
+
+#if defined(AUG_NEON)
+
+static void S16toF32_NEON(const int16_t* Src, float* Dst, size_t Count)
+{
+	const float32x4_t Scale = vdupq_n_f32(S16Scale);
+	size_t i = 0;
+	for (; i + 8 <= Count; i += 8)
+	{
+		const int16x8_t v = vld1q_s16(Src + i);
+		vst1q_f32(Dst + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), Scale));
+		vst1q_f32(Dst + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), Scale));
+	}
+	S16toF32_Scalar(Src + i, Dst + i, Count - i);
+}
+
+static void S24toF32_NEON(const uint8_t* Src, float* Dst, size_t Count)
+{
+	const float32x4_t Scale = vdupq_n_f32(S24Scale);
+	size_t i = 0;
+	for (; i + 8 <= Count; i += 8)
+	{
+		const uint8x8x3_t b = vld3_u8(Src + i * 3); // deinterleave byte planes
+		const uint16x8_t b0 = vmovl_u8(b.val[0]);
+		const uint16x8_t b1 = vmovl_u8(b.val[1]);
+		const uint16x8_t b2 = vmovl_u8(b.val[2]);
+		const uint16x8_t lo16 = vorrq_u16(b0, vshlq_n_u16(b1, 8)); // bits 0..15
+		for (int h = 0; h < 2; ++h)
+		{
+			const uint32x4_t lo = vmovl_u16(h ? vget_high_u16(lo16) : vget_low_u16(lo16));
+			const uint32x4_t hi = vmovl_u16(h ? vget_high_u16(b2) : vget_low_u16(b2));
+			const int32x4_t v = vshrq_n_s32(vreinterpretq_s32_u32(vorrq_u32(vshlq_n_u32(lo, 8), vshlq_n_u32(hi, 24))), 8);
+			vst1q_f32(Dst + i + h * 4, vmulq_f32(vcvtq_f32_s32(v), Scale));
+		}
+	}
+	S24toF32_Scalar(Src + i * 3, Dst + i, Count - i);
+}
+
+static void S32toF32_NEON(const int32_t* Src, float* Dst, size_t Count)
+{
+	const float32x4_t Scale = vdupq_n_f32(S32Scale);
+	size_t i = 0;
+	for (; i + 4 <= Count; i += 4)
+	{
+		vst1q_f32(Dst + i, vmulq_f32(vcvtq_f32_s32(vld1q_s32(Src + i)), Scale));
+	}
+	S32toF32_Scalar(Src + i, Dst + i, Count - i);
+}
+
+static void F32toS16_NEON(const float* Src, int16_t* Dst, size_t Count)
+{
+	const float32x4_t Scale = vdupq_n_f32(32768.0f);
+	size_t i = 0;
+	for (; i + 8 <= Count; i += 8)
+	{
+		// vcvtnq saturates to int32, vqmovn saturates to int16
+		const int32x4_t a = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(Src + i), Scale));
+		const int32x4_t b = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(Src + i + 4), Scale));
+		vst1q_s16(Dst + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+	}
+	F32toS16_Scalar(Src + i, Dst + i, Count - i);
+}
+
+static void Downmix_NEON(const float* Src, float* Dst, size_t NumFrames, uint32_t NumChannels)
+{
+	size_t i = 0;
+	if (NumChannels == 2)
+	{
+		const float32x4_t Scale = vdupq_n_f32(0.5f);
+		for (; i + 4 <= NumFrames; i += 4)
+		{
+			const float32x4x2_t lr = vld2q_f32(Src + i * 2);
+			vst1q_f32(Dst + i, vmulq_f32(vaddq_f32(lr.val[0], lr.val[1]), Scale));
+		}
+	}
+	Downmix_Scalar(Src + i * NumChannels, Dst + i, NumFrames - i, NumChannels);
+}
+
+static float SumSquares_NEON(const float* Src, size_t Count)
+{
+	float32x4_t Acc = vdupq_n_f32(0.0f);
+	size_t i = 0;
+	for (; i + 4 <= Count; i += 4)
+	{
+		const float32x4_t x = vld1q_f32(Src + i);
+		Acc = vmlaq_f32(Acc, x, x);
+	}
+	return vaddvq_f32(Acc) + SumSquares_Scalar(Src + i, Count - i);
+}
+
+static float PeakAbs_NEON(const float* Src, size_t Count)
+{
+	float32x4_t Acc = vdupq_n_f32(0.0f);
+	size_t i = 0;
+	for (; i + 4 <= Count; i += 4)
+	{
+		Acc = vmaxq_f32(Acc, vabsq_f32(vld1q_f32(Src + i)));
+	}
+	return std::max(vmaxvq_f32(Acc), PeakAbs_Scalar(Src + i, Count - i));
+}
+
+#endif // AUG_NEON
+
+//=================================================================================================
+// DISPATCH
+
+static const WaveKernels ScalarKernels = {
+	"Scalar",
+	S16toF32_Scalar, S24toF32_Scalar, S32toF32_Scalar, F32toS16_Scalar,
+	Downmix_Scalar, SumSquares_Scalar, PeakAbs_Scalar, ZeroCrossings_Scalar
+};
+
+#if defined(AUG_X86)
+static const WaveKernels SSE2Kernels = {
+	"SSE2",
+	S16toF32_SSE2, S24toF32_Scalar, S32toF32_SSE2, F32toS16_SSE2,
+	Downmix_SSE2, SumSquares_SSE2, PeakAbs_SSE2, ZeroCrossings_SSE2
+};
+
+static const WaveKernels AVX2Kernels = {
+	"AVX2",
+	S16toF32_AVX2, S24toF32_AVX2, S32toF32_AVX2, F32toS16_AVX2,
+	Downmix_AVX2, SumSquares_AVX2, PeakAbs_AVX2, ZeroCrossings_SSE2
+};
+#endif
+
+#if defined(AUG_NEON)
+static const WaveKernels NEONKernels = {
+	"NEON",
+	S16toF32_NEON, S24toF32_NEON, S32toF32_NEON, F32toS16_NEON,
+	Downmix_NEON, SumSquares_NEON, PeakAbs_NEON, ZeroCrossings_Scalar
+};
+#endif
+
+std::vector<const WaveKernels*> GetSupportedWaveKernels()
+{
+	std::vector<const WaveKernels*> Res;
+	Res.push_back(&ScalarKernels);
+
+	#if defined(AUG_X86)
+	Res.push_back(&SSE2Kernels); // x64 baseline
+	if (CpuHasAvx2())
+		Res.push_back(&AVX2Kernels);
+	#endif
+
+	#if defined(AUG_NEON)
+	Res.push_back(&NEONKernels); // arm64 baseline
+	#endif
+
+	return Res;
+}
+
+const WaveKernels& GetWaveKernels()
+{
+	static const WaveKernels* Best = []()
+	{
+		const WaveKernels* Kernels = GetSupportedWaveKernels().back();
+		logi("WaveKernels: {}", Kernels->Name);
+		return Kernels;
+	}();
+	return *Best;
+}